@@ -5,5 +5,6 @@ export * from './socket'
 export * from './fullscreen'
 export * from './telemetry'
 export * from './analytics'
+export * from './loop-timing'
 export * from './featureFlags'
 export * from './location-store'
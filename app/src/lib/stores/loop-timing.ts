@@ -0,0 +1,5 @@
+import { LoopTimingData } from '$lib/platform_shared/message'
+import { createHistoryStore } from './history-store'
+
+// One entry per second of control loop ticks: per-stage min/avg/p99/max, busy time and wake jitter.
+export const loopTiming = createHistoryStore(LoopTimingData, 60)
@@ -8,6 +8,7 @@
 #include <map>
 #include <type_traits>
 #include <communication/proto_helpers.h>
+#include <utils/trace.h>
 
 class CommAdapterBase {
   public:
@@ -40,6 +41,7 @@ class CommAdapterBase {
         constexpr pb_size_t tag = MessageTraits<T>::tag;
 
         if (clientId < 0 && !hasSubscribers(tag)) return;
+        TRACE_SCOPE_VALUE("ws emit", tag);
 
         msg_.which_message = tag;
         MessageTraits<T>::assign(msg_, data);
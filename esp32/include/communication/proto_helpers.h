@@ -34,6 +34,12 @@ DEFINE_MESSAGE_TRAITS(I2CScanData, i2c_scan)
 DEFINE_MESSAGE_TRAITS(PeripheralSettingsData, peripheral_settings)
 DEFINE_MESSAGE_TRAITS(ControllerData, controller_data)
 DEFINE_MESSAGE_TRAITS(WalkGaitData, walk_gait)
+DEFINE_MESSAGE_TRAITS(LoopTimingData, loop_timing)
+DEFINE_MESSAGE_TRAITS(ControlLoopRateData, control_loop_rate)
+DEFINE_MESSAGE_TRAITS(FlightRecorderDump, flight_recorder_dump)
+DEFINE_MESSAGE_TRAITS(FlightRecorderFreeze, flight_recorder_freeze)
+DEFINE_MESSAGE_TRAITS(TaskStatsData, task_stats)
+DEFINE_MESSAGE_TRAITS(TaskStatsIntervalData, task_stats_interval)
 DEFINE_MESSAGE_TRAITS(IMUCalibrateExecute, imu_calibrate_execute)
 DEFINE_MESSAGE_TRAITS(I2CScanDataRequest, i2c_scan_data_request)
 DEFINE_MESSAGE_TRAITS(PeripheralSettingsDataRequest, peripheral_settings_data_request)
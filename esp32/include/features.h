@@ -43,6 +43,14 @@
 #define USE_MDNS 1
 #endif
 
+#ifndef USE_TRACE
+#define USE_TRACE 0
+#endif
+
+#ifndef KINEMATICS_FAST_MATH
+#define KINEMATICS_FAST_MATH 0
+#endif
+
 #if defined(SPOTMICRO_ESP32) && defined(SPOTMICRO_ESP32_MINI) && defined(SPOTMICRO_YERTLE)
 #error "Only one kinematics variant must be defined"
 #endif
@@ -2,32 +2,95 @@
 #define Kinematics_h
 
 #include <utils/math_utils.h>
+#include <utils/fast_math.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Trig used by the IK solver. KINEMATICS_FAST_MATH=1 swaps in the polynomial approximations from fast_math.h; the
+ * resulting joint angles stay within 0.01 deg of the libm solution over the reachable workspace (see
+ * test/host/test_kinematics.cpp for the sweep).
+ */
+#ifndef KINEMATICS_FAST_MATH
+#define KINEMATICS_FAST_MATH 0
+#endif
 
-class KinConfig {
-  public:
-#if defined(SPOTMICRO_ESP32)
+struct StdTrig {
+    static inline float atan2(float y, float x) { return atan2f(y, x); }
+    static inline float acos(float x) { return acosf(x); }
+    static inline float sin(float x) { return sinf(x); }
+    static inline float cos(float x) { return cosf(x); }
+};
+
+struct FastTrig {
+    static inline float atan2(float y, float x) { return fast_math::fast_atan2f(y, x); }
+    static inline float acos(float x) { return fast_math::fast_acosf(x); }
+    static inline float sin(float x) { return fast_math::fast_sinf(x); }
+    static inline float cos(float x) { return fast_math::fast_cosf(x); }
+};
+
+#if KINEMATICS_FAST_MATH
+using KinTrig = FastTrig;
+#else
+using KinTrig = StdTrig;
+#endif
+
+/*
+ * Robot geometry, one parameter struct per supported build. Lengths are in meters; absolute_tibia is set when the
+ * knee servo drives the tibia angle relative to the body rather than to the femur.
+ */
+struct SpotMicroESP32 {
+    static constexpr const char *name = "SPOTMICRO_ESP32";
     static constexpr float coxa = 0.0605f;
     static constexpr float coxa_offset = 0.010f;
     static constexpr float femur = 0.1112f;
     static constexpr float tibia = 0.1185f;
     static constexpr float L = 0.2075f;
     static constexpr float W = 0.078f;
-#elif defined(SPOTMICRO_ESP32_MINI)
+    static constexpr bool absolute_tibia = false;
+};
+
+struct SpotMicroESP32Mini {
+    static constexpr const char *name = "SPOTMICRO_ESP32_MINI";
     static constexpr float coxa = 0.035f;
     static constexpr float coxa_offset = 0.0f;
     static constexpr float femur = 0.060f;
     static constexpr float tibia = 0.060f;
     static constexpr float L = 0.160f;
     static constexpr float W = 0.080f;
-#elif defined(SPOTMICRO_YERTLE)
+    static constexpr bool absolute_tibia = false;
+};
+
+struct SpotMicroYertle {
+    static constexpr const char *name = "SPOTMICRO_YERTLE";
     static constexpr float coxa = 0.035f;
     static constexpr float coxa_offset = 0.0f;
     static constexpr float femur = 0.130f;
     static constexpr float tibia = 0.130f;
     static constexpr float L = 0.240f;
     static constexpr float W = 0.078f;
+    static constexpr bool absolute_tibia = true;
+};
+
+#if defined(SPOTMICRO_ESP32)
+using KinVariant = SpotMicroESP32;
+#elif defined(SPOTMICRO_ESP32_MINI)
+using KinVariant = SpotMicroESP32Mini;
+#elif defined(SPOTMICRO_YERTLE)
+using KinVariant = SpotMicroYertle;
 #endif
 
+template <class Variant>
+class KinematicsConfig : public Variant {
+  public:
+    using Variant::coxa;
+    using Variant::coxa_offset;
+    using Variant::femur;
+    using Variant::tibia;
+    using Variant::L;
+    using Variant::W;
+
     static constexpr float mountOffsets[4][3] = {
         {L / 2, 0, W / 2}, {L / 2, 0, -W / 2}, {-L / 2, 0, W / 2}, {-L / 2, 0, -W / 2}};
 
@@ -60,6 +123,9 @@ class KinConfig {
     static constexpr float default_step_height = default_body_height / 2;
 };
 
+// Limits and defaults of the robot this firmware is built for.
+using KinConfig = KinematicsConfig<KinVariant>;
+
 struct alignas(16) body_state_t {
     float omega {0}, phi {0}, psi {0}, xm {0}, ym {KinConfig::default_body_height}, zm {0};
     float feet[4][4];
@@ -76,44 +142,82 @@ struct alignas(16) body_state_t {
     }
 };
 
+/*
+ * Structure-of-arrays view over N body states for batched IK. Every pointer addresses `count` consecutive floats;
+ * feet[leg][axis] holds the x/y/z world position of that foot for each pose.
+ */
+struct body_state_soa_t {
+    size_t count {0};
+    const float *omega {nullptr}, *phi {nullptr}, *psi {nullptr};
+    const float *xm {nullptr}, *ym {nullptr}, *zm {nullptr};
+    const float *feet[4][3] {};
+};
+
+/*
+ * Profiling counters for the incremental solver. legs_solved / calls is the average number of legs re-solved per
+ * tick (4 for a full solve).
+ */
+struct ik_stats_t {
+    uint32_t calls {0};
+    uint32_t pose_updates {0};
+    uint32_t legs_solved {0};
+    uint8_t last_legs_solved {0};
+};
+
+template <class Variant = KinVariant>
 class Kinematics {
   private:
-    static constexpr float coxa = KinConfig::coxa;
-    static constexpr float coxa_offset = KinConfig::coxa_offset;
-    static constexpr float femur = KinConfig::femur;
-    static constexpr float tibia = KinConfig::tibia;
+    static constexpr float coxa = Variant::coxa;
+    static constexpr float coxa_offset = Variant::coxa_offset;
+    static constexpr float femur = Variant::femur;
+    static constexpr float tibia = Variant::tibia;
 
-    static constexpr float L = KinConfig::L;
-    static constexpr float W = KinConfig::W;
+    static constexpr float L = Variant::L;
+    static constexpr float W = Variant::W;
 
     static constexpr float mountOffsets[4][3] = {
         {L / 2, 0, W / 2}, {L / 2, 0, -W / 2}, {-L / 2, 0, W / 2}, {-L / 2, 0, -W / 2}};
 
     static constexpr float invMountRot[3][3] = {{0, 0, -1}, {0, 1, 0}, {1, 0, 0}};
 
+    static constexpr size_t BATCH_BLOCK = 64;
+
     alignas(16) float rot[3][3] = {0};
     alignas(16) float inv_rot[3][3] = {0};
     alignas(16) float inv_trans[3] = {0};
+    alignas(16) float leg_angles[4][3] = {0};
 
     body_state_t currentState;
+    bool pose_valid = false;
+    uint8_t valid_legs = 0;
+
+    ik_stats_t _stats;
+
+    // Change thresholds for the incremental solver: well below servo resolution, so skipping never stalls a leg
+    // that is slowly creeping through stance.
+    static constexpr float POSE_ANGLE_EPSILON = 1e-4f; // degrees
+    static constexpr float POSITION_EPSILON = 1e-5f;   // meters
+
+    inline bool poseChanged(const body_state_t &body_state) const {
+        return !pose_valid || !IS_EQUAL(currentState.omega, body_state.omega, POSE_ANGLE_EPSILON) ||
+               !IS_EQUAL(currentState.phi, body_state.phi, POSE_ANGLE_EPSILON) ||
+               !IS_EQUAL(currentState.psi, body_state.psi, POSE_ANGLE_EPSILON) ||
+               !IS_EQUAL(currentState.xm, body_state.xm, POSITION_EPSILON) ||
+               !IS_EQUAL(currentState.ym, body_state.ym, POSITION_EPSILON) ||
+               !IS_EQUAL(currentState.zm, body_state.zm, POSITION_EPSILON);
+    }
 
-  public:
-    esp_err_t calculate_inverse_kinematics(const body_state_t body_state, float result[12]) {
-        esp_err_t ret = ESP_OK;
-
-        if (currentState == body_state) return ESP_OK;
-
-        currentState.omega = body_state.omega;
-        currentState.phi = body_state.phi;
-        currentState.psi = body_state.psi;
-        currentState.xm = body_state.xm;
-        currentState.ym = body_state.ym;
-        currentState.zm = body_state.zm;
-        currentState.updateFeet(body_state.feet);
-
-        float roll = body_state.omega * DEG2RAD_F;
-        float pitch = body_state.phi * DEG2RAD_F;
-        float yaw = body_state.psi * DEG2RAD_F;
+    inline bool footChanged(const body_state_t &body_state, int leg) const {
+        return !(valid_legs & (1 << leg)) ||
+               !IS_EQUAL(currentState.feet[leg][0], body_state.feet[leg][0], POSITION_EPSILON) ||
+               !IS_EQUAL(currentState.feet[leg][1], body_state.feet[leg][1], POSITION_EPSILON) ||
+               !IS_EQUAL(currentState.feet[leg][2], body_state.feet[leg][2], POSITION_EPSILON);
+    }
+
+    void updateBodyTransform() {
+        float roll = currentState.omega * DEG2RAD_F;
+        float pitch = currentState.phi * DEG2RAD_F;
+        float yaw = currentState.psi * DEG2RAD_F;
         euler2R(roll, pitch, yaw, rot);
         inverse(rot, inv_rot);
 
@@ -123,42 +227,149 @@ class Kinematics {
             -inv_rot[1][0] * currentState.xm - inv_rot[1][1] * currentState.ym - inv_rot[1][2] * currentState.zm;
         inv_trans[2] =
             -inv_rot[2][0] * currentState.xm - inv_rot[2][1] * currentState.ym - inv_rot[2][2] * currentState.zm;
+    }
 
-        for (int i = 0; i < 4; i++) {
-            float wx = currentState.feet[i][0];
-            float wy = currentState.feet[i][1];
-            float wz = currentState.feet[i][2];
+    void solveLeg(int i) {
+        float wx = currentState.feet[i][0];
+        float wy = currentState.feet[i][1];
+        float wz = currentState.feet[i][2];
 
-            float bx = inv_rot[0][0] * wx + inv_rot[0][1] * wy + inv_rot[0][2] * wz + inv_trans[0];
-            float by = inv_rot[1][0] * wx + inv_rot[1][1] * wy + inv_rot[1][2] * wz + inv_trans[1];
-            float bz = inv_rot[2][0] * wx + inv_rot[2][1] * wy + inv_rot[2][2] * wz + inv_trans[2];
+        float bx = inv_rot[0][0] * wx + inv_rot[0][1] * wy + inv_rot[0][2] * wz + inv_trans[0];
+        float by = inv_rot[1][0] * wx + inv_rot[1][1] * wy + inv_rot[1][2] * wz + inv_trans[1];
+        float bz = inv_rot[2][0] * wx + inv_rot[2][1] * wy + inv_rot[2][2] * wz + inv_trans[2];
 
-            float mx = mountOffsets[i][0];
-            float my = mountOffsets[i][1];
-            float mz = mountOffsets[i][2];
+        float mx = mountOffsets[i][0];
+        float my = mountOffsets[i][1];
+        float mz = mountOffsets[i][2];
 
-            float px = bx - mx;
-            float py = by - my;
-            float pz = bz - mz;
+        float px = bx - mx;
+        float py = by - my;
+        float pz = bz - mz;
 
-            float lx = invMountRot[0][0] * px + invMountRot[0][1] * py + invMountRot[0][2] * pz;
-            float ly = invMountRot[1][0] * px + invMountRot[1][1] * py + invMountRot[1][2] * pz;
-            float lz = invMountRot[2][0] * px + invMountRot[2][1] * py + invMountRot[2][2] * pz;
+        float lx = invMountRot[0][0] * px + invMountRot[0][1] * py + invMountRot[0][2] * pz;
+        float ly = invMountRot[1][0] * px + invMountRot[1][1] * py + invMountRot[1][2] * pz;
+        float lz = invMountRot[2][0] * px + invMountRot[2][1] * py + invMountRot[2][2] * pz;
 
-            float xLocal = (i % 2 == 1) ? -lx : lx;
-            legIK(xLocal, ly, lz, result + i * 3);
+        float xLocal = (i % 2 == 1) ? -lx : lx;
+        legIK(xLocal, ly, lz, leg_angles[i]);
+    }
+
+  public:
+    using Config = KinematicsConfig<Variant>;
+
+    /*
+     * Solves joint angles for `body_state` incrementally: the body rotation/translation is only rebuilt when the
+     * pose changed, and only legs whose foot target moved (or all legs after a pose change) are re-solved. Cached
+     * angles are written to `result` for the rest, so `result` is always fully populated.
+     */
+    esp_err_t calculate_inverse_kinematics(const body_state_t &body_state, float result[12]) {
+        _stats.calls++;
+
+        if (poseChanged(body_state)) {
+            currentState.omega = body_state.omega;
+            currentState.phi = body_state.phi;
+            currentState.psi = body_state.psi;
+            currentState.xm = body_state.xm;
+            currentState.ym = body_state.ym;
+            currentState.zm = body_state.zm;
+            updateBodyTransform();
+            pose_valid = true;
+            valid_legs = 0;
+            _stats.pose_updates++;
         }
 
-        return ret;
+        uint8_t solved = 0;
+        for (int i = 0; i < 4; i++) {
+            if (footChanged(body_state, i)) {
+                currentState.feet[i][0] = body_state.feet[i][0];
+                currentState.feet[i][1] = body_state.feet[i][1];
+                currentState.feet[i][2] = body_state.feet[i][2];
+                solveLeg(i);
+                valid_legs |= 1 << i;
+                solved++;
+            }
+            result[i * 3 + 0] = leg_angles[i][0];
+            result[i * 3 + 1] = leg_angles[i][1];
+            result[i * 3 + 2] = leg_angles[i][2];
+        }
+        _stats.last_legs_solved = solved;
+        _stats.legs_solved += solved;
+
+        return ESP_OK;
     }
 
-    inline void euler2R(float roll, float pitch, float yaw, float rot[3][3]) {
-        float cos_roll = std::cos(roll);
-        float sin_roll = std::sin(roll);
-        float cos_pitch = std::cos(pitch);
-        float sin_pitch = std::sin(pitch);
-        float cos_yaw = std::cos(yaw);
-        float sin_yaw = std::sin(yaw);
+    const ik_stats_t &stats() const { return _stats; }
+
+    void resetStats() { _stats = {}; }
+
+    /*
+     * Solves IK for every pose in `batch`, writing count x 12 joint angles (same layout as
+     * calculate_inverse_kinematics) to `result`. Poses are processed in blocks: the body transform and leg-local
+     * coordinates are computed for the whole block in flat loops before the per-leg solve, so the compiler can keep
+     * each stage in SIMD lanes on the host and software-pipeline it on target.
+     */
+    static void calculate_inverse_kinematics_batch(const body_state_soa_t &batch, float *result) {
+        alignas(16) float r[9][BATCH_BLOCK];
+        alignas(16) float t[3][BATCH_BLOCK];
+        alignas(16) float local[3][BATCH_BLOCK];
+        alignas(16) float out[3][BATCH_BLOCK];
+
+        for (size_t base = 0; base < batch.count; base += BATCH_BLOCK) {
+            const size_t n = std::min(BATCH_BLOCK, batch.count - base);
+
+            for (size_t k = 0; k < n; k++) {
+                float rot[3][3];
+                euler2R(batch.omega[base + k] * DEG2RAD_F, batch.phi[base + k] * DEG2RAD_F,
+                        batch.psi[base + k] * DEG2RAD_F, rot);
+                const float xm = batch.xm[base + k], ym = batch.ym[base + k], zm = batch.zm[base + k];
+                // Inverse rotation is the transpose, stored row-major across r[0..8].
+                for (int i = 0; i < 3; i++) {
+                    r[i * 3 + 0][k] = rot[0][i];
+                    r[i * 3 + 1][k] = rot[1][i];
+                    r[i * 3 + 2][k] = rot[2][i];
+                    t[i][k] = -rot[0][i] * xm - rot[1][i] * ym - rot[2][i] * zm;
+                }
+            }
+
+            for (int leg = 0; leg < 4; leg++) {
+                const float *fx = batch.feet[leg][0] + base;
+                const float *fy = batch.feet[leg][1] + base;
+                const float *fz = batch.feet[leg][2] + base;
+                const float mx = mountOffsets[leg][0], my = mountOffsets[leg][1], mz = mountOffsets[leg][2];
+                for (size_t k = 0; k < n; k++) {
+                    const float px = r[0][k] * fx[k] + r[1][k] * fy[k] + r[2][k] * fz[k] + t[0][k] - mx;
+                    const float py = r[3][k] * fx[k] + r[4][k] * fy[k] + r[5][k] * fz[k] + t[1][k] - my;
+                    const float pz = r[6][k] * fx[k] + r[7][k] * fy[k] + r[8][k] * fz[k] + t[2][k] - mz;
+                    const float lx = invMountRot[0][0] * px + invMountRot[0][1] * py + invMountRot[0][2] * pz;
+                    local[0][k] = (leg % 2 == 1) ? -lx : lx;
+                    local[1][k] = invMountRot[1][0] * px + invMountRot[1][1] * py + invMountRot[1][2] * pz;
+                    local[2][k] = invMountRot[2][0] * px + invMountRot[2][1] * py + invMountRot[2][2] * pz;
+                }
+                for (size_t k = 0; k < n; k++) {
+                    float angles[3];
+                    legIK(local[0][k], local[1][k], local[2][k], angles);
+                    out[0][k] = angles[0];
+                    out[1][k] = angles[1];
+                    out[2][k] = angles[2];
+                }
+                for (size_t k = 0; k < n; k++) {
+                    float *dst = result + (base + k) * 12 + leg * 3;
+                    dst[0] = out[0][k];
+                    dst[1] = out[1][k];
+                    dst[2] = out[2][k];
+                }
+            }
+        }
+    }
+
+    template <class Trig = KinTrig>
+    static inline void euler2R(float roll, float pitch, float yaw, float rot[3][3]) {
+        float cos_roll = Trig::cos(roll);
+        float sin_roll = Trig::sin(roll);
+        float cos_pitch = Trig::cos(pitch);
+        float sin_pitch = Trig::sin(pitch);
+        float cos_yaw = Trig::cos(yaw);
+        float sin_yaw = Trig::sin(yaw);
 
         rot[0][0] = cos_pitch * cos_yaw;
         rot[0][1] = -sin_yaw * cos_pitch;
@@ -171,7 +382,7 @@ class Kinematics {
         rot[2][2] = cos_roll * cos_pitch;
     }
 
-    inline void inverse(float rot[3][3], float inv_rot[3][3]) {
+    static inline void inverse(float rot[3][3], float inv_rot[3][3]) {
         inv_rot[0][0] = rot[0][0];
         inv_rot[0][1] = rot[1][0];
         inv_rot[0][2] = rot[2][0];
@@ -183,22 +394,109 @@ class Kinematics {
         inv_rot[2][2] = rot[2][2];
     }
 
-    inline void legIK(float x, float y, float z, float out[3]) {
-        float F = sqrt(fmax(0.0f, x * x + y * y - coxa * coxa));
+    template <class Trig = KinTrig>
+    static inline void legIK(float x, float y, float z, float out[3]) {
+        float F = sqrtf(fmaxf(0.0f, x * x + y * y - coxa * coxa));
         float G = F - coxa_offset;
-        float H = sqrt(G * G + z * z);
+        float H = sqrtf(G * G + z * z);
 
-        float theta1 = -atan2f(y, x) - atan2f(F, -coxa);
-        float D = (H * H - femur * femur - tibia * tibia) / (2 * femur * tibia);
-        float theta3 = acosf(fmax(-1.0f, fmin(1.0f, D)));
-        float theta2 = atan2f(z, G) - atan2f(tibia * sinf(theta3), femur + tibia * cosf(theta3));
+        float theta1 = -Trig::atan2(y, x) - Trig::atan2(F, -coxa);
+        float D = fmaxf(-1.0f, fminf(1.0f, (H * H - femur * femur - tibia * tibia) / (2 * femur * tibia)));
+        float theta3 = Trig::acos(D);
+        // sin(acos(D)) and cos(acos(D)) in closed form, saves a sin/cos pair per leg
+        float theta2 = Trig::atan2(z, G) - Trig::atan2(tibia * sqrtf(1.0f - D * D), femur + tibia * D);
         out[0] = RAD_TO_DEG_F(theta1);
         out[1] = RAD_TO_DEG_F(theta2);
-#if defined(SPOTMICRO_ESP32) || defined(SPOTMICRO_ESP32_MINI)
-        out[2] = RAD_TO_DEG_F(theta3);
-#elif defined(SPOTMICRO_YERTLE)
-        out[2] = RAD_TO_DEG_F(theta3 + theta2);
-#endif
+        out[2] = RAD_TO_DEG_F(Variant::absolute_tibia ? theta3 + theta2 : theta3);
+    }
+
+    /*
+     * Inverse of legIK: joint angles in degrees (as produced by legIK) to the foot position in the leg frame.
+     */
+    static inline void legFK(const float angles[3], float out[3]) {
+        float theta1 = DEG_TO_RAD_F(angles[0]);
+        float theta2 = DEG_TO_RAD_F(angles[1]);
+        float theta23 = Variant::absolute_tibia ? DEG_TO_RAD_F(angles[2]) : theta2 + DEG_TO_RAD_F(angles[2]);
+        float G = femur * cosf(theta2) + tibia * cosf(theta23);
+        float F = G + coxa_offset;
+        float s1 = sinf(theta1), c1 = cosf(theta1);
+        out[0] = -coxa * c1 - F * s1;
+        out[1] = coxa * s1 - F * c1;
+        out[2] = femur * sinf(theta2) + tibia * sinf(theta23);
+    }
+
+    /*
+     * Foot positions for the 12 joint angles produced by calculate_inverse_kinematics (before any servo direction
+     * mapping). feet_body is relative to the body centre in the body frame; feet_world applies the pose of
+     * `body_state` (its feet are ignored). Either output may be nullptr.
+     */
+    static void calculate_forward_kinematics(const body_state_t &body_state, const float angles[12],
+                                             float feet_body[4][3], float feet_world[4][3] = nullptr) {
+        float rot[3][3];
+        if (feet_world) {
+            euler2R(body_state.omega * DEG2RAD_F, body_state.phi * DEG2RAD_F, body_state.psi * DEG2RAD_F, rot);
+        }
+        for (int i = 0; i < 4; i++) {
+            float body[3];
+            legToBody(i, angles + i * 3, body);
+            if (feet_body) {
+                feet_body[i][0] = body[0];
+                feet_body[i][1] = body[1];
+                feet_body[i][2] = body[2];
+            }
+            if (feet_world) {
+                feet_world[i][0] = rot[0][0] * body[0] + rot[0][1] * body[1] + rot[0][2] * body[2] + body_state.xm;
+                feet_world[i][1] = rot[1][0] * body[0] + rot[1][1] * body[1] + rot[1][2] * body[2] + body_state.ym;
+                feet_world[i][2] = rot[2][0] * body[0] + rot[2][1] * body[1] + rot[2][2] * body[2] + body_state.zm;
+            }
+        }
+    }
+
+    /*
+     * Analytic Jacobian of the body-frame foot position of `leg` with respect to its three joint angles, in meters
+     * per radian: J[axis][joint]. Foot velocity is J * joint rates, joint torques for a foot force are J^T * F.
+     */
+    static void legJacobian(int leg, const float angles[3], float J[3][3]) {
+        float theta1 = DEG_TO_RAD_F(angles[0]);
+        float theta2 = DEG_TO_RAD_F(angles[1]);
+        float theta23 = Variant::absolute_tibia ? DEG_TO_RAD_F(angles[2]) : theta2 + DEG_TO_RAD_F(angles[2]);
+        float s1 = sinf(theta1), c1 = cosf(theta1);
+        float fs2 = femur * sinf(theta2), fc2 = femur * cosf(theta2);
+        float ts23 = tibia * sinf(theta23), tc23 = tibia * cosf(theta23);
+        float F = fc2 + tc23 + coxa_offset;
+
+        // Leg frame partials: columns are d/d(theta1), d/d(theta2), d/d(theta3) of (x, y, z).
+        float dG[3] = {0, -fs2 - ts23, -ts23};
+        float dz[3] = {0, fc2 + tc23, tc23};
+        float local[3][3] = {
+            {coxa * s1 - F * c1, -s1 * dG[1], -s1 * dG[2]},
+            {coxa * c1 + F * s1, -c1 * dG[1], -c1 * dG[2]},
+            {dz[0], dz[1], dz[2]},
+        };
+        if constexpr (Variant::absolute_tibia) {
+            // The third servo drives the absolute tibia angle, so theta3 = q3 - q2.
+            for (int axis = 0; axis < 3; axis++) local[axis][1] -= local[axis][2];
+        }
+        const float sign = (leg % 2 == 1) ? -1.0f : 1.0f;
+        for (int joint = 0; joint < 3; joint++) {
+            J[0][joint] = local[2][joint];
+            J[1][joint] = local[1][joint];
+            J[2][joint] = -sign * local[0][joint];
+        }
+    }
+
+  private:
+    // Leg frame to body frame, the inverse of the mount transform applied in solveLeg.
+    static inline void legToBody(int leg, const float angles[3], float body[3]) {
+        float local[3];
+        legFK(angles, local);
+        const float lx = (leg % 2 == 1) ? -local[0] : local[0];
+        body[0] = invMountRot[0][0] * lx + invMountRot[1][0] * local[1] + invMountRot[2][0] * local[2];
+        body[1] = invMountRot[0][1] * lx + invMountRot[1][1] * local[1] + invMountRot[2][1] * local[2];
+        body[2] = invMountRot[0][2] * lx + invMountRot[1][2] * local[1] + invMountRot[2][2] * local[2];
+        body[0] += mountOffsets[leg][0];
+        body[1] += mountOffsets[leg][1];
+        body[2] += mountOffsets[leg][2];
     }
 };
 
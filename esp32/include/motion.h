@@ -8,6 +8,8 @@
 #include <peripherals/peripherals.h>
 #include <utils/timing.h>
 #include <utils/math_utils.h>
+#include <utils/mailbox.h>
+#include <utils/command_log.h>
 
 #include <motion_states/state.h>
 #include <motion_states/walk_state.h>
@@ -27,27 +29,83 @@ class MotionService {
 
     void onControlLinkLost();
 
+    // Mode and gait changes are queued like controller input and take effect at the next update().
     void handleWalkGait(const socket_message_WalkGaitData& data);
 
     void handleMode(const socket_message_ModeData& data);
 
+    // Whether a mode runs a motion state, i.e. whether isActive() will hold once handleMode() took effect.
+    static bool isActiveMode(MOTION_STATE mode);
+
     void setState(MotionState* newState);
 
     void handleGestures(const gesture_t ges);
 
+    // Steps the motion stack by the time since the previous update.
     bool update(Peripherals* peripherals);
 
-    bool update_angles(float new_angles[12], float angles[12]);
+    // Steps the motion stack by dt seconds, as measured by a loop that times its own wake-ups.
+    bool update(Peripherals* peripherals, float dt);
+
+    bool update_angles(const float new_angles[12], float angles[12]);
 
     float* getAngles() { return angles; }
 
+    // Joint targets before the trajectory limits, the angles getAngles() is moving towards.
+    const float* getTargetAngles() const { return target_angles; }
+
+    const body_state_t& bodyState() const { return body_state; }
+
+    MOTION_STATE mode() const;
+
+    const ik_stats_t& kinematicsStats() const { return kinematics.stats(); }
+
+    // Age of the last controller command when the control loop picked it up, microseconds.
+    int64_t commandLatency() const { return command_latency; }
+
+    // Controller commands overwritten before the control loop consumed them.
+    uint32_t droppedCommands() const { return dropped_commands; }
+
     inline bool isActive() { return state != nullptr; }
 
+    // Commands, mode changes and gestures reaching this service are also logged to the recorder, if one is set.
+    void setRecorder(command_log::Recorder* recorder) { this->recorder = recorder; }
+
   private:
-    Kinematics kinematics;
+    Kinematics<> kinematics;
 
     CommandMsg command = {0, 0, 0, 0, 0, 0, 0};
 
+    // Written by the websocket task (handleInput, onControlLinkLost), drained once per control tick.
+    Mailbox<CommandMsg> commands;
+    CommandMsg last_posted = {0, 0, 0, 0, 0, 0, 0};
+    uint32_t last_command_sequence = 0;
+    uint32_t dropped_commands = 0;
+    int64_t command_latency = 0;
+
+    void applyPendingCommand(int64_t now);
+
+    /*
+     * Mode and gait requests from the websocket task, applied by the control task so it is the only writer of the
+     * motion state and the trajectory limits. Every post carries the latest request of both kinds, so a gait change
+     * cannot overwrite an unread mode change; the per-kind sequence tells a new request from one already applied,
+     * and asking for the current mode again still re-enters it.
+     */
+    struct motion_request_t {
+        MOTION_STATE mode = MOTION_STATE::DEACTIVATED;
+        socket_message_WalkGaits gait = socket_message_WalkGaits_TROT;
+        uint32_t mode_sequence = 0;
+        uint32_t gait_sequence = 0;
+    };
+    Mailbox<motion_request_t> requests;
+    motion_request_t last_requested; // websocket task owned
+    uint32_t applied_mode_sequence = 0;
+    uint32_t applied_gait_sequence = 0;
+
+    void applyPendingRequest();
+
+    command_log::Recorder* recorder = nullptr;
+
     friend class MotionState;
 
     MotionState* state = nullptr;
@@ -59,7 +117,12 @@ class MotionService {
     body_state_t body_state;
 
     float new_angles[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
-    float angles[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    // Joint targets from the kinematics (or handleAngles), and the trajectory-limited angles sent to the servos.
+    float target_angles[12] = {0, 90, -145, 0, 90, -145, 0, 90, -145, 0, 90, -145};
+    float angles[12] = {0, 90, -145, 0, 90, -145, 0, 90, -145, 0, 90, -145};
+    TrajectoryGenerator<12> trajectory;
+
+    void applyJointLimits();
 
     float dir[12] = {1, -1, -1, -1, -1, -1, 1, -1, -1, -1, -1, -1};
 
@@ -17,7 +17,7 @@ class RestState : public MotionState {
     }
 
     void step(body_state_t &body_state, float dt = 0.02f) override {
-        lerpToBody(body_state);
+        moveToBody(body_state, dt);
         updateFeet(body_state);
     }
 };
\ No newline at end of file
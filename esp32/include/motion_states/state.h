@@ -1,8 +1,10 @@
 #pragma once
 
+#include <esp_log.h>
 #include <kinematics.h>
 #include <message_types.h>
 #include <utils/math_utils.h>
+#include <utils/trajectory.h>
 #include <cstring>
 
 class MotionState {
@@ -10,24 +12,35 @@ class MotionState {
     virtual const char* name() const = 0;
     static constexpr const float (&default_feet_pos)[4][4] = KinConfig::default_feet_positions;
     body_state_t target_body_state;
-    static constexpr float default_smoothing_factor = 0.03f;
+    // Time constant of the gait parameter and IMU compensation filters, seconds.
+    static constexpr float settle_time = 0.33f;
+    // Joint limits in degrees: posture changes move gently, the gait gets roughly what hobby servos can do.
+    static constexpr joint_limits_t posture_limits {120.0f, 600.0f};
+    static constexpr joint_limits_t gait_limits {600.0f, 30000.0f};
     float omega_offset = 0, psi_offset = 0;
+    float omega_compensation = 0, psi_compensation = 0;
 
-    void lerpToBody(body_state_t& body_state, const bool imuCompensate = false,
-                    const float smoothing_factor = default_smoothing_factor) {
-        body_state.xm = lerp(body_state.xm, target_body_state.xm, smoothing_factor);
-        body_state.ym = lerp(body_state.ym, target_body_state.ym, smoothing_factor);
-        body_state.zm = lerp(body_state.zm, target_body_state.zm, smoothing_factor);
-        body_state.phi = lerp(body_state.phi, target_body_state.phi, smoothing_factor);
-        const float target_psi =
-            clamp(target_body_state.psi - imuCompensate * psi_offset, -KinConfig::max_pitch, KinConfig::max_pitch);
-        const float target_omega =
-            clamp(target_body_state.omega - imuCompensate * omega_offset, -KinConfig::max_roll, KinConfig::max_roll);
-        body_state.psi = lerp(body_state.psi, target_psi, smoothing_factor);
-        body_state.omega = lerp(body_state.omega, target_omega, smoothing_factor);
+    // Fraction of the way a first-order filter with time constant settle_time moves in dt.
+    static float settleFactor(float dt) { return 1.0f - std::exp(-dt / settle_time); }
+
+    /*
+     * Takes the target pose as is; the joint trajectory in MotionService shapes the motion. IMU compensation is a
+     * feedback loop through the body pose, so it alone is low-passed to stay stable.
+     */
+    void moveToBody(body_state_t& body_state, float dt, const bool imuCompensate = false) {
+        const float k = settleFactor(dt);
+        omega_compensation = lerp(omega_compensation, imuCompensate ? omega_offset : 0.0f, k);
+        psi_compensation = lerp(psi_compensation, imuCompensate ? psi_offset : 0.0f, k);
+        body_state.xm = target_body_state.xm;
+        body_state.ym = target_body_state.ym;
+        body_state.zm = target_body_state.zm;
+        body_state.phi = target_body_state.phi;
+        body_state.psi = clamp(target_body_state.psi - psi_compensation, -KinConfig::max_pitch, KinConfig::max_pitch);
+        body_state.omega =
+            clamp(target_body_state.omega - omega_compensation, -KinConfig::max_roll, KinConfig::max_roll);
     }
 
-    void updateFeet(body_state_t& body_state, const float smoothing_factor = default_smoothing_factor) {
+    void updateFeet(body_state_t& body_state) {
         if (std::memcmp(target_body_state.feet, body_state.feet, sizeof(body_state.feet)) != 0) {
             body_state.updateFeet(target_body_state.feet);
         }
@@ -47,4 +60,8 @@ class MotionState {
     virtual void handleCommand(const CommandMsg& cmd) {}
 
     virtual void step(body_state_t& body_state, float dt = 0.02f) {}
+
+    virtual joint_limits_t jointLimits(int) const { return posture_limits; }
+
+    static constexpr joint_limits_t postureLimits() { return posture_limits; }
 };
\ No newline at end of file
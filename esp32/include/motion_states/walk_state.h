@@ -1,10 +1,10 @@
 #pragma once
 
 #include <motion_states/state.h>
+#include <motion_states/gait_curves.h>
 #include <utils/math_utils.h>
 #include <algorithm>
 #include <array>
-#include <functional>
 
 struct gait_state_t {
     float step_height {KinConfig::default_step_height};
@@ -46,28 +46,6 @@ class WalkState : public MotionState {
         float time_to_lift = INFINITY;
     };
 
-    static constexpr uint8_t BEZIER_POINTS = 12;
-    static constexpr std::array<float, BEZIER_POINTS> COMBINATORIAL_VALUES = {
-        combinatorial_constexpr(11, 0),  // 1
-        combinatorial_constexpr(11, 1),  // 11
-        combinatorial_constexpr(11, 2),  // 55
-        combinatorial_constexpr(11, 3),  // 165
-        combinatorial_constexpr(11, 4),  // 330
-        combinatorial_constexpr(11, 5),  // 462
-        combinatorial_constexpr(11, 6),  // 462
-        combinatorial_constexpr(11, 7),  // 330
-        combinatorial_constexpr(11, 8),  // 165
-        combinatorial_constexpr(11, 9),  // 55
-        combinatorial_constexpr(11, 10), // 11
-        combinatorial_constexpr(11, 11)  // 1
-    };
-
-    alignas(32) static constexpr float BEZIER_STEPS[12] = {-1.0f, -1.4f, -1.5f, -1.5f, -1.5f, 0.0f,
-                                                           0.0f,  0.0f,  1.5f,  1.5f,  1.4f,  1.0f};
-
-    alignas(32) static constexpr float BEZIER_HEIGHTS[12] = {0.0f, 0.0f, 0.9f, 0.9f, 0.9f, 0.9f,
-                                                             0.9f, 1.1f, 1.1f, 1.1f, 0.0f, 0.0f};
-
   public:
     WalkState() = default;
     const char *name() const override { return "Bezier"; }
@@ -88,14 +66,16 @@ class WalkState : public MotionState {
     }
 
     void step(body_state_t &body_state, float dt = 0.02f) override {
-        body_state.ym = lerp(body_state.ym, target_body_state.ym, default_smoothing_factor);
-        body_state.psi = lerp(body_state.psi, target_body_state.psi, default_smoothing_factor);
+        // Step parameters ramp so the feet blend between gaits; joint motion itself is shaped downstream.
+        const float k = settleFactor(dt);
+        body_state.ym = target_body_state.ym;
+        body_state.psi = target_body_state.psi;
         gait_state.step_height = target_gait_state.step_height;
-        gait_state.step_x = lerp(gait_state.step_x, target_gait_state.step_x, default_smoothing_factor);
-        gait_state.step_z = lerp(gait_state.step_z, target_gait_state.step_z, default_smoothing_factor);
+        gait_state.step_x = lerp(gait_state.step_x, target_gait_state.step_x, k);
+        gait_state.step_z = lerp(gait_state.step_z, target_gait_state.step_z, k);
         gait_state.step_velocity = target_gait_state.step_velocity;
-        gait_state.step_angle = lerp(gait_state.step_angle, target_gait_state.step_angle, default_smoothing_factor);
-        gait_state.step_depth = lerp(gait_state.step_depth, target_gait_state.step_depth, default_smoothing_factor);
+        gait_state.step_angle = lerp(gait_state.step_angle, target_gait_state.step_angle, k);
+        gait_state.step_depth = lerp(gait_state.step_depth, target_gait_state.step_depth, k);
 
         step_length = std::hypot(gait_state.step_x, gait_state.step_z);
         if (gait_state.step_x < 0.0f) step_length = -step_length;
@@ -104,6 +84,8 @@ class WalkState : public MotionState {
         updateFeetPositions(body_state);
     }
 
+    joint_limits_t jointLimits(int) const override { return gait_limits; }
+
   protected:
     void handleCommand(const CommandMsg &cmd) override {
         target_body_state.ym = KinConfig::min_body_height + cmd.h * KinConfig::body_height_range;
@@ -229,60 +211,31 @@ class WalkState : public MotionState {
     }
 
     void standController(body_state_t &body_state, const int index, const float phase) {
-        controller(index, body_state, phase, stanceCurve, &gait_state.step_depth);
+        controller<StanceCurve>(index, body_state, phase, gait_state.step_depth);
     }
 
     void swingController(body_state_t &body_state, const int index, const float phase) {
-        controller(index, body_state, phase, bezierCurve, &gait_state.step_height);
+        controller<BezierSwingCurve>(index, body_state, phase, gait_state.step_height);
     }
 
-    void controller(const int index, body_state_t &body_state, const float phase,
-                    std::function<void(float, float, float *, float, float *)> curve, float *arg) {
+    template <class Curve>
+    void controller(const int index, body_state_t &body_state, const float phase, const float arg) {
         float delta_pos[3] = {0};
         float delta_rot[3] = {0};
 
         float length = step_length * 0.5f;
         float angle = std::atan2(gait_state.step_z, step_length) * 2.0f;
-        curve(length, angle, arg, phase, delta_pos);
+        Curve::apply(length, angle, arg, phase, delta_pos);
 
         length = gait_state.step_angle * KinConfig::max_step_length;
         angle = yawArc(default_feet_pos[index], body_state.feet[index]);
-        curve(length, angle, arg, phase, delta_rot);
+        Curve::apply(length, angle, arg, phase, delta_rot);
 
         body_state.feet[index][0] += delta_pos[0] + delta_rot[0] * 0.2;
         if (step_length || gait_state.step_angle) body_state.feet[index][1] += delta_pos[1] + delta_rot[1] * 0.2;
         body_state.feet[index][2] += delta_pos[2] + delta_rot[2] * 0.2;
     }
 
-    static void stanceCurve(const float length, const float angle, const float *depth, const float phase,
-                            float *point) {
-        float step = length * (1.0f - 2.0f * phase);
-        point[0] += step * std::cos(angle);
-        point[2] += step * std::sin(angle);
-        if (length != 0.0f) point[1] = -*depth * std::cos((M_PI * (point[0] + point[2])) / (2.f * length));
-    }
-
-    static void bezierCurve(const float length, const float angle, const float *height, const float phase,
-                            float *point) {
-        const float X_POLAR = std::cos(angle);
-        const float Z_POLAR = std::sin(angle);
-
-        const float t = std::clamp(phase, 1e-4f, 1.f - 1e-4f);
-        float phase_power = 1.0f;
-        float inv_phase_power = std::pow(1.0f - t, 11);
-        const float one_minus_phase = 1.0f - t;
-
-        for (int i = 0; i < 12; i++) {
-            float b = COMBINATORIAL_VALUES[i] * phase_power * inv_phase_power;
-            point[0] += b * BEZIER_STEPS[i] * length * X_POLAR;
-            point[1] += b * BEZIER_HEIGHTS[i] * *height;
-            point[2] += b * BEZIER_STEPS[i] * length * Z_POLAR;
-
-            phase_power *= t;
-            inv_phase_power /= one_minus_phase;
-        }
-    }
-
     static float yawArc(const float feet_pos[3], const float *current_pos) {
         const float foot_mag = std::hypot(feet_pos[0], feet_pos[2]);
         const float foot_dir = std::atan2(feet_pos[2], feet_pos[0]);
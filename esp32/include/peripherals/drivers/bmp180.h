@@ -1,14 +1,98 @@
 #pragma once
 
 #include <peripherals/i2c_bus.h>
+#include <esp_timer.h>
+#include <atomic>
 #include <cmath>
 
+struct bmp180_calibration_t {
+    int16_t ac1, ac2, ac3;
+    uint16_t ac4, ac5, ac6;
+    int16_t b1, b2;
+    int16_t mb, mc, md;
+};
+
+/*
+ * Datasheet integer compensation, split so the per-sample work is minimal: constants that only depend on the
+ * calibration are folded once in the constructor, and the pressure terms that only depend on temperature are folded
+ * whenever a new temperature arrives. Converting a pressure sample is then a multiply, a divide and the second order
+ * correction.
+ */
+class BMP180Compensation {
+  public:
+    BMP180Compensation() = default;
+
+    BMP180Compensation(const bmp180_calibration_t &cal, uint8_t oss)
+        : _oss(oss),
+          _ac1x4(cal.ac1 * 4),
+          _ac2(cal.ac2),
+          _ac3(cal.ac3),
+          _ac4(cal.ac4),
+          _ac5(cal.ac5),
+          _ac6(cal.ac6),
+          _b1(cal.b1),
+          _b2(cal.b2),
+          _mc_shifted(static_cast<int32_t>(cal.mc) * 2048),
+          _md(cal.md),
+          _b7_scale(50000u >> oss) {}
+
+    // Takes the raw temperature, returns it in 0.1 degC and refreshes the temperature dependent pressure terms.
+    int32_t setTemperature(int32_t ut) {
+        int32_t x1 = ((ut - _ac6) * _ac5) >> 15;
+        int32_t x2 = _mc_shifted / (x1 + _md);
+        const int32_t b5 = x1 + x2;
+
+        const int32_t b6 = b5 - 4000;
+        const int32_t b6_sq = (b6 * b6) >> 12;
+        x1 = (_b2 * b6_sq) >> 11;
+        x2 = (_ac2 * b6) >> 11;
+        _b3 = (((_ac1x4 + x1 + x2) << _oss) + 2) >> 2;
+        x1 = (_ac3 * b6) >> 13;
+        x2 = (_b1 * b6_sq) >> 16;
+        const int32_t x3 = ((x1 + x2) + 2) >> 2;
+        _b4 = (_ac4 * static_cast<uint32_t>(x3 + 32768)) >> 15;
+
+        return (b5 + 8) >> 4;
+    }
+
+    // Raw pressure (already shifted by 8 - oss) to Pa, using the terms of the last setTemperature().
+    int32_t pressure(int32_t up) const {
+        const uint32_t b7 = (static_cast<uint32_t>(up) - _b3) * _b7_scale;
+        int32_t p = b7 < 0x80000000 ? (b7 << 1) / _b4 : (b7 / _b4) << 1;
+        int32_t x1 = (p >> 8) * (p >> 8);
+        x1 = (x1 * 3038) >> 16;
+        const int32_t x2 = (-7357 * p) >> 16;
+        return p + ((x1 + x2 + 3791) >> 4);
+    }
+
+  private:
+    uint8_t _oss {0};
+    int32_t _ac1x4 {0}, _ac2 {0}, _ac3 {0};
+    uint32_t _ac4 {0};
+    int32_t _ac5 {0}, _ac6 {0};
+    int32_t _b1 {0}, _b2 {0};
+    int32_t _mc_shifted {0}, _md {0};
+    uint32_t _b7_scale {0};
+
+    int32_t _b3 {0};
+    uint32_t _b4 {1};
+};
+
+/*
+ * Non-blocking BMP180 driver. update() never waits for a conversion: it starts one and returns, and a later call
+ * collects the result once the conversion time has passed, then immediately starts the next. Pressure is sampled
+ * back to back; temperature, which drifts slowly, is refreshed every TEMPERATURE_INTERVAL_US.
+ *
+ * Results are read out through the I2C queue at SENSOR priority, behind servo frames. With a bus worker the read
+ * lands on a later update(); without one update() serves the queue itself and carries on at once.
+ */
 class BMP180Driver {
   public:
     static constexpr uint8_t DEFAULT_ADDR = 0x77;
     static constexpr float SEA_LEVEL_HPA = 1013.25f;
+    static constexpr int64_t TEMPERATURE_INTERVAL_US = 1000000;
 
-    BMP180Driver(uint8_t addr = DEFAULT_ADDR) : _addr(addr) {}
+    BMP180Driver(uint8_t addr = DEFAULT_ADDR, uint8_t oss = 0) : _addr(addr), _oss(oss > 3 ? 3 : oss) {}
 
     bool begin() {
         if (!I2CBus::instance().probe(_addr)) return false;
@@ -16,64 +100,58 @@ class BMP180Driver {
         uint8_t id = readReg8(REG_CHIP_ID);
         if (id != 0x55) return false;
 
-        _ac1 = readReg16(0xAA);
-        _ac2 = readReg16(0xAC);
-        _ac3 = readReg16(0xAE);
-        _ac4 = readReg16U(0xB0);
-        _ac5 = readReg16U(0xB2);
-        _ac6 = readReg16U(0xB4);
-        _b1 = readReg16(0xB6);
-        _b2 = readReg16(0xB8);
-        _mb = readReg16(0xBA);
-        _mc = readReg16(0xBC);
-        _md = readReg16(0xBE);
-
+        uint8_t raw[22];
+        if (I2CBus::instance().readReg(_addr, REG_CALIBRATION, raw, sizeof(raw)) != ESP_OK) return false;
+        auto word = [&](int i) { return static_cast<uint16_t>((raw[2 * i] << 8) | raw[2 * i + 1]); };
+        bmp180_calibration_t cal;
+        cal.ac1 = word(0);
+        cal.ac2 = word(1);
+        cal.ac3 = word(2);
+        cal.ac4 = word(3);
+        cal.ac5 = word(4);
+        cal.ac6 = word(5);
+        cal.b1 = word(6);
+        cal.b2 = word(7);
+        cal.mb = word(8);
+        cal.mc = word(9);
+        cal.md = word(10);
+        _compensation = BMP180Compensation(cal, _oss);
+
+        _state = State::IDLE;
         _initialized = true;
         return true;
     }
 
-    bool update() {
+    // Advances the conversion state machine. Returns true when a new pressure sample was completed.
+    bool update(int64_t now = esp_timer_get_time()) {
         if (!_initialized) return false;
 
-        writeReg(REG_CONTROL, CMD_TEMP);
-        vTaskDelay(pdMS_TO_TICKS(5));
-        int32_t ut = readReg16(REG_OUT_MSB);
-
-        writeReg(REG_CONTROL, CMD_PRESSURE + (_oss << 6));
-        vTaskDelay(pdMS_TO_TICKS(2 + (3 << _oss)));
-
-        int32_t up = readReg24(REG_OUT_MSB) >> (8 - _oss);
-
-        int32_t x1 = ((ut - _ac6) * _ac5) >> 15;
-        int32_t x2 = (_mc << 11) / (x1 + _md);
-        int32_t b5 = x1 + x2;
-        _temperature = ((b5 + 8) >> 4) / 10.0f;
-
-        int32_t b6 = b5 - 4000;
-        x1 = (_b2 * ((b6 * b6) >> 12)) >> 11;
-        x2 = (_ac2 * b6) >> 11;
-        int32_t x3 = x1 + x2;
-        int32_t b3 = (((_ac1 * 4 + x3) << _oss) + 2) >> 2;
-        x1 = (_ac3 * b6) >> 13;
-        x2 = (_b1 * ((b6 * b6) >> 12)) >> 16;
-        x3 = ((x1 + x2) + 2) >> 2;
-        uint32_t b4 = (_ac4 * (uint32_t)(x3 + 32768)) >> 15;
-        uint32_t b7 = ((uint32_t)up - b3) * (50000 >> _oss);
-        int32_t p;
-        if (b7 < 0x80000000) {
-            p = (b7 << 1) / b4;
-        } else {
-            p = (b7 / b4) << 1;
+        switch (_state) {
+            case State::IDLE: startTemperature(now); return false;
+
+            case State::TEMPERATURE: {
+                if (now < _ready_at || !readOut(2, now)) return false;
+                const uint8_t *buf = _out;
+                _temperature = _compensation.setTemperature((buf[0] << 8) | buf[1]) / 10.0f;
+                _temperature_at = now;
+                startPressure(now);
+                return false;
+            }
+
+            case State::PRESSURE: {
+                if (now < _ready_at || !readOut(3, now)) return false;
+                const uint8_t *buf = _out;
+                const int32_t up = ((buf[0] << 16) | (buf[1] << 8) | buf[2]) >> (8 - _oss);
+                _pressure = _compensation.pressure(up) / 100.0f;
+                _altitude = 44330.0f * (1.0f - powf(_pressure * (1.0f / SEA_LEVEL_HPA), 0.1903f));
+                if (now - _temperature_at >= TEMPERATURE_INTERVAL_US)
+                    startTemperature(now);
+                else
+                    startPressure(now);
+                return true;
+            }
         }
-        x1 = (p >> 8) * (p >> 8);
-        x1 = (x1 * 3038) >> 16;
-        x2 = (-7357 * p) >> 16;
-        p = p + ((x1 + x2 + 3791) >> 4);
-
-        _pressure = p / 100.0f;
-        _altitude = 44330.0f * (1.0f - powf(_pressure / SEA_LEVEL_HPA, 0.1903f));
-
-        return true;
+        return false;
     }
 
     float getPressure() const { return _pressure; }
@@ -82,46 +160,82 @@ class BMP180Driver {
     bool isInitialized() const { return _initialized; }
 
   private:
+    static constexpr uint8_t REG_CALIBRATION = 0xAA;
     static constexpr uint8_t REG_CHIP_ID = 0xD0;
     static constexpr uint8_t REG_CONTROL = 0xF4;
     static constexpr uint8_t REG_OUT_MSB = 0xF6;
     static constexpr uint8_t CMD_TEMP = 0x2E;
     static constexpr uint8_t CMD_PRESSURE = 0x34;
+    static constexpr int64_t TEMPERATURE_CONVERSION_US = 4500;
 
-    void writeReg(uint8_t reg, uint8_t val) { I2CBus::instance().writeReg(_addr, reg, &val, 1); }
+    enum class State : uint8_t { IDLE, TEMPERATURE, PRESSURE };
+    enum class ReadOut : uint8_t { NONE, QUEUED, DONE, FAILED };
 
-    uint8_t readReg8(uint8_t reg) {
-        uint8_t val = 0;
-        I2CBus::instance().readReg(_addr, reg, &val, 1);
-        return val;
+    // Datasheet maximum conversion times: 4.5, 7.5, 13.5 and 25.5 ms for oss 0..3.
+    int64_t pressureConversionUs() const { return 1500 + (3000 << _oss); }
+
+    void startTemperature(int64_t now) {
+        _state = writeReg(REG_CONTROL, CMD_TEMP) ? State::TEMPERATURE : State::IDLE;
+        _ready_at = now + TEMPERATURE_CONVERSION_US;
     }
 
-    int16_t readReg16(uint8_t reg) {
-        uint8_t buf[2];
-        I2CBus::instance().readReg(_addr, reg, buf, 2);
-        return (int16_t)((buf[0] << 8) | buf[1]);
+    void startPressure(int64_t now) {
+        _state = writeReg(REG_CONTROL, CMD_PRESSURE + (_oss << 6)) ? State::PRESSURE : State::IDLE;
+        _ready_at = now + pressureConversionUs();
+    }
+
+    /*
+     * Queues the read of a finished conversion into _out, then reports whether it has arrived. A read that failed or
+     * was not served within a conversion time drops back to IDLE so the next update restarts with a fresh conversion.
+     */
+    bool readOut(size_t len, int64_t now) {
+        I2CBus &bus = I2CBus::instance();
+        if (_read_out.load(std::memory_order_acquire) == ReadOut::NONE) {
+            i2c_transaction_t read;
+            read.addr = _addr;
+            read.priority = I2CPriority::SENSOR;
+            read.write[0] = REG_OUT_MSB;
+            read.write_len = 1;
+            read.read = _out;
+            read.read_len = len;
+            read.deadline = now + pressureConversionUs();
+            read.done = readOutDone;
+            read.ctx = this;
+            _read_out.store(ReadOut::QUEUED, std::memory_order_relaxed);
+            if (bus.submit(read) != ESP_OK) _read_out.store(ReadOut::FAILED, std::memory_order_relaxed);
+            if (!bus.hasWorker()) bus.runPending();
+        }
+        const ReadOut result = _read_out.load(std::memory_order_acquire);
+        if (result == ReadOut::QUEUED) return false;
+        _read_out.store(ReadOut::NONE, std::memory_order_relaxed);
+        if (result == ReadOut::DONE) return true;
+        _state = State::IDLE;
+        return false;
     }
 
-    uint16_t readReg16U(uint8_t reg) {
-        uint8_t buf[2];
-        I2CBus::instance().readReg(_addr, reg, buf, 2);
-        return (uint16_t)((buf[0] << 8) | buf[1]);
+    static void readOutDone(esp_err_t err, void *ctx) {
+        auto *self = static_cast<BMP180Driver *>(ctx);
+        self->_read_out.store(err == ESP_OK ? ReadOut::DONE : ReadOut::FAILED, std::memory_order_release);
     }
 
-    int32_t readReg24(uint8_t reg) {
-        uint8_t buf[3];
-        I2CBus::instance().readReg(_addr, reg, buf, 3);
-        return ((int32_t)buf[0] << 16) | ((int32_t)buf[1] << 8) | buf[2];
+    bool writeReg(uint8_t reg, uint8_t val) { return I2CBus::instance().writeReg(_addr, reg, &val, 1) == ESP_OK; }
+
+    uint8_t readReg8(uint8_t reg) {
+        uint8_t val = 0;
+        I2CBus::instance().readReg(_addr, reg, &val, 1);
+        return val;
     }
 
     uint8_t _addr;
+    uint8_t _oss;
     bool _initialized = false;
-    uint8_t _oss = 0;
 
-    int16_t _ac1, _ac2, _ac3;
-    uint16_t _ac4, _ac5, _ac6;
-    int16_t _b1, _b2;
-    int16_t _mb, _mc, _md;
+    BMP180Compensation _compensation;
+    State _state {State::IDLE};
+    int64_t _ready_at {0};
+    int64_t _temperature_at {0};
+    uint8_t _out[3] {};
+    std::atomic<ReadOut> _read_out {ReadOut::NONE};
 
     float _temperature = 0;
     float _pressure = 0;
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <driver/gpio.h>
+#include <esp_attr.h>
+#include <esp_rom_sys.h>
+#include <esp_timer.h>
+
+#include <atomic>
+#include <cstdint>
+
+/*
+ * HC-SR04 ultrasonic ranger with interrupt-timed echoes. trigger() sends the 10 us start pulse and returns; the echo
+ * edges are timestamped in a GPIO interrupt and poll() turns the pulse width into a distance. Trigger and echo may
+ * share one pin (one-wire wiring), in which case the pin is flipped to input after the pulse.
+ */
+class HCSR04Driver {
+  public:
+    enum class Status { IDLE, PENDING, DONE, NO_ECHO };
+
+    static constexpr float US_PER_CM = 58.0f; // round trip at ~343 m/s
+
+    ~HCSR04Driver() {
+        if (_initialized) gpio_isr_handler_remove(_echo);
+    }
+
+    bool begin(int trigger, int echo, float max_cm) {
+        if (trigger < 0 || echo < 0) return false;
+        _trigger = static_cast<gpio_num_t>(trigger);
+        _echo = static_cast<gpio_num_t>(echo);
+        // The module raises echo ~0.5 ms after the trigger pulse, allow for that on top of the round trip.
+        _timeout_us = static_cast<int64_t>(max_cm * US_PER_CM) + 1000;
+
+        esp_err_t err = gpio_install_isr_service(0);
+        if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) return false;
+
+        gpio_reset_pin(_echo);
+        gpio_set_direction(_echo, GPIO_MODE_INPUT);
+        gpio_set_intr_type(_echo, GPIO_INTR_ANYEDGE);
+        if (gpio_isr_handler_add(_echo, echoIsr, this) != ESP_OK) return false;
+        if (_trigger != _echo) {
+            gpio_reset_pin(_trigger);
+            gpio_set_direction(_trigger, GPIO_MODE_OUTPUT);
+            gpio_set_level(_trigger, 0);
+        }
+        _initialized = true;
+        return true;
+    }
+
+    // Starts a ping; costs the 10 us trigger pulse. Returns false while the previous ping is still in flight.
+    bool trigger(int64_t now = esp_timer_get_time()) {
+        if (!_initialized || _status == Status::PENDING) return false;
+        _edges.store(0, std::memory_order_relaxed);
+        if (_trigger == _echo) {
+            gpio_intr_disable(_echo);
+            gpio_set_direction(_trigger, GPIO_MODE_OUTPUT);
+        }
+        gpio_set_level(_trigger, 1);
+        esp_rom_delay_us(10);
+        gpio_set_level(_trigger, 0);
+        if (_trigger == _echo) {
+            gpio_set_direction(_echo, GPIO_MODE_INPUT);
+            gpio_intr_enable(_echo);
+        }
+        _triggered = now;
+        _status = Status::PENDING;
+        return true;
+    }
+
+    // Completes the current ping. On DONE, `cm` holds the measured distance.
+    Status poll(float &cm, int64_t now = esp_timer_get_time()) {
+        if (_status != Status::PENDING) return _status;
+        const uint8_t edges = _edges.load(std::memory_order_acquire);
+        const uint32_t rise = _rise.load(std::memory_order_relaxed);
+        const uint32_t fall = _fall.load(std::memory_order_relaxed);
+        // Re-checked so a stray edge landing between the loads is not paired with the wrong stamp.
+        if (edges == (RISE_SEEN | FALL_SEEN) && _edges.load(std::memory_order_acquire) == edges) {
+            cm = static_cast<uint32_t>(fall - rise) / US_PER_CM;
+            _status = Status::DONE;
+        } else if (now - _triggered > _timeout_us) {
+            _status = Status::NO_ECHO;
+        }
+        return _status;
+    }
+
+    bool isInitialized() const { return _initialized; }
+
+  private:
+    static constexpr uint8_t RISE_SEEN = 1;
+    static constexpr uint8_t FALL_SEEN = 2;
+
+    static void IRAM_ATTR echoIsr(void *arg) {
+        auto *self = static_cast<HCSR04Driver *>(arg);
+        const uint32_t now = static_cast<uint32_t>(esp_timer_get_time());
+        if (gpio_get_level(self->_echo)) {
+            self->_rise.store(now, std::memory_order_relaxed);
+            self->_edges.store(RISE_SEEN, std::memory_order_release);
+        } else if (self->_edges.load(std::memory_order_relaxed) & RISE_SEEN) {
+            self->_fall.store(now, std::memory_order_relaxed);
+            self->_edges.store(RISE_SEEN | FALL_SEEN, std::memory_order_release);
+        }
+    }
+
+    gpio_num_t _trigger {GPIO_NUM_NC};
+    gpio_num_t _echo {GPIO_NUM_NC};
+    int64_t _timeout_us {0};
+    int64_t _triggered {0};
+    // Edge stamps keep the low 32 bits of esp_timer: each is one store the task cannot see half of, and the pulse
+    // width is their unsigned difference, right across the 71 minute wrap. _edges is published after the stamp.
+    std::atomic<uint32_t> _rise {0};
+    std::atomic<uint32_t> _fall {0};
+    std::atomic<uint8_t> _edges {0};
+    Status _status {Status::IDLE};
+    bool _initialized {false};
+};
@@ -2,47 +2,135 @@
 
 #include <peripherals/i2c_bus.h>
 #include <utils/math_utils.h>
+#include <utils/ring_buffer.h>
+#include <utils/attitude_filter.h>
+#include <driver/gpio.h>
+#include <esp_attr.h>
+#include <esp_timer.h>
+
+#include <algorithm>
+#include <atomic>
+
+#ifndef IMU_FUSION_FIXED_POINT
+// Run the raw mode attitude filter in Q8.24 integer arithmetic, for targets without an FPU.
+#define IMU_FUSION_FIXED_POINT 0
+#endif
+
+struct imu_packet_t {
+    int64_t time {0};        // esp_timer time (us) the sample was taken
+    float q[4] {1, 0, 0, 0}; // w, x, y, z
+};
 
+/*
+ * MPU6050 producing attitude quaternions through the FIFO, in one of two modes:
+ *
+ *   DMP  the on-chip DMP firmware fuses the sensors and queues quaternions at its internal rate.
+ *   RAW  the FIFO queues raw accel + gyro at 1 kHz and a Madgwick filter on the MCU fuses every sample. Skips the
+ *        3 KB firmware upload and the DMP's fixed rate and latency.
+ *
+ * Each update drains every queued packet in one burst read into a ring of timestamped quaternions, and the
+ * temperature is read on its own slow schedule.
+ *
+ * With the INT pin wired (begin(int_pin), DMP mode), the data-ready interrupt timestamps each sample and wakes an
+ * optional reader task; update() then touches the bus only when the interrupt reported new data. Otherwise update()
+ * polls the FIFO count and stamps the newest packet with the read time.
+ */
 class MPU6050Driver {
   public:
+    enum class Mode : uint8_t { DMP, RAW };
+
+#if IMU_FUSION_FIXED_POINT
+    using Fusion = MadgwickFixed;
+#else
+    using Fusion = MadgwickFloat;
+#endif
+
     static constexpr uint8_t DEFAULT_ADDR = 0x68;
+    static constexpr size_t PACKET_RING = 16;
+    static constexpr int64_t TEMPERATURE_INTERVAL_US = 1000000;
+    static constexpr int64_t RAW_SAMPLE_PERIOD_US = 1000;
 
-    MPU6050Driver(uint8_t addr = DEFAULT_ADDR) : _addr(addr) {}
+    MPU6050Driver(uint8_t addr = DEFAULT_ADDR, Mode mode = Mode::DMP)
+        : _addr(addr), _mode(mode), _sample_period_us(mode == Mode::RAW ? RAW_SAMPLE_PERIOD_US : 10000) {}
 
-    bool begin() {
+    ~MPU6050Driver() {
+        if (_int_pin >= 0) gpio_isr_handler_remove(static_cast<gpio_num_t>(_int_pin));
+    }
+
+    bool begin(int int_pin = -1) {
         if (!I2CBus::instance().probe(_addr)) return false;
 
         uint8_t whoami = readReg(REG_WHO_AM_I);
         if (whoami != 0x68 && whoami != 0x72) return false;
 
-        if (dmpInitialize() != 0) return false;
+        if (_mode == Mode::RAW) {
+            rawInitialize();
+        } else {
+            if (dmpInitialize() != 0) return false;
 
-        setDMPEnabled(true);
-        vTaskDelay(pdMS_TO_TICKS(100));
-        resetFIFO();
-        vTaskDelay(pdMS_TO_TICKS(50));
+            setDMPEnabled(true);
+            vTaskDelay(pdMS_TO_TICKS(100));
+            resetFIFO();
+            vTaskDelay(pdMS_TO_TICKS(50));
+
+            // Raw samples arrive at 1 kHz, too often to wake the reader for each; that mode polls the FIFO.
+            if (int_pin >= 0 && !attachInterrupt(int_pin)) return false;
+        }
 
         _initialized = true;
         return true;
     }
 
-    bool update() {
+    // Task to notify from the data-ready interrupt, typically the one calling update().
+    void setReader(TaskHandle_t reader) { _reader = reader; }
+
+    bool isInterruptDriven() const { return _int_pin >= 0; }
+
+    // Returns true when new packets were read.
+    bool update(int64_t now = esp_timer_get_time()) {
         if (!_initialized) return false;
 
-        if (dmpGetCurrentFIFOPacket(_fifoBuffer)) {
-            float q[4];
-            dmpGetQuaternion(q, _fifoBuffer);
-            dmpGetGravity(_gravity, q);
-            dmpGetYawPitchRoll(_rpy, q, _gravity);
-        }
+        bool fresh = false;
+        int64_t newest = now;
+        if (_int_pin < 0 || latestInterrupt(newest)) fresh = drainFIFO(newest);
 
-        uint8_t buf[2];
-        if (I2CBus::instance().readReg(_addr, REG_TEMP_OUT_H, buf, 2) == ESP_OK) {
-            int16_t rawTemp = (buf[0] << 8) | buf[1];
-            _temp = rawTemp / 340.0f + 36.53f;
+        if (now - _temp_time >= TEMPERATURE_INTERVAL_US) {
+            uint8_t buf[2];
+            if (I2CBus::instance().readReg(_addr, REG_TEMP_OUT_H, buf, 2) == ESP_OK) {
+                int16_t rawTemp = (buf[0] << 8) | buf[1];
+                _temp = rawTemp / 340.0f + 36.53f;
+            }
+            _temp_time = now;
         }
 
-        return true;
+        return fresh;
+    }
+
+    /*
+     * Decodes `count` FIFO packets, oldest first, into the ring. The newest is stamped `newest_time` and earlier ones
+     * are spaced by the sample period: fixed in RAW mode, estimated from arrival times for the DMP. RAW packets are
+     * run through the attitude filter one by one.
+     */
+    void ingestPackets(const uint8_t* data, size_t count, int64_t newest_time) {
+        if (!count) return;
+        if (_mode == Mode::DMP && _packets.size()) {
+            const int64_t interval = (newest_time - _packets.back().time) / static_cast<int64_t>(count);
+            if (interval > 0 && interval < 4 * _sample_period_us)
+                _sample_period_us += (interval - _sample_period_us) / 8;
+        }
+        for (size_t i = 0; i < count; i++) {
+            imu_packet_t packet;
+            packet.time = newest_time - static_cast<int64_t>(count - 1 - i) * _sample_period_us;
+            if (_mode == Mode::RAW) {
+                fuseRawSample(data + i * RAW_PACKET_SIZE);
+                _fusion.quaternion(packet.q);
+            } else {
+                dmpGetQuaternion(packet.q, data + i * DMP_PACKET_SIZE);
+            }
+            _packets.push(packet);
+        }
+        dmpGetGravity(_gravity, _packets.back().q);
+        dmpGetYawPitchRoll(_rpy, _packets.back().q, _gravity);
     }
 
     bool calibrate() {
@@ -60,6 +148,13 @@ class MPU6050Driver {
     float getTemperature() const { return _temp; }
     bool isInitialized() const { return _initialized; }
 
+    // Newest samples, oldest first.
+    const RingBuffer<imu_packet_t, PACKET_RING>& packets() const { return _packets; }
+    int64_t getSampleTime() const { return _packets.empty() ? 0 : _packets.back().time; }
+    int64_t samplePeriodUs() const { return _sample_period_us; }
+    uint32_t fifoResets() const { return _fifo_resets; }
+    Mode mode() const { return _mode; }
+
   private:
     static constexpr uint8_t REG_XG_OFFS_USRH = 0x13;
     static constexpr uint8_t REG_XA_OFFS_H = 0x06;
@@ -88,6 +183,14 @@ class MPU6050Driver {
     static constexpr uint8_t REG_WHO_AM_I = 0x75;
 
     static constexpr uint16_t DMP_PACKET_SIZE = 28;
+    static constexpr uint16_t RAW_PACKET_SIZE = 12; // accel xyz, gyro xyz, big endian
+    // Packets drained per burst: 80 ms of DMP output, 32 ms of raw samples. A FIFO holding more is stale and gets reset.
+    static constexpr uint16_t DMP_MAX_BURST_PACKETS = 8;
+    static constexpr uint16_t RAW_MAX_BURST_PACKETS = 32;
+    static constexpr uint16_t MAX_BURST_BYTES =
+        std::max(DMP_MAX_BURST_PACKETS * DMP_PACKET_SIZE, RAW_MAX_BURST_PACKETS * RAW_PACKET_SIZE);
+    static constexpr float ACCEL_G_PER_LSB = 1.0f / 16384.0f;    // +-2 g
+    static constexpr float GYRO_RAD_PER_LSB = DEG2RAD_F / 65.5f; // +-500 dps
     static constexpr uint16_t DMP_CODE_SIZE = 3062;
 
     static constexpr uint8_t dmpMemory[DMP_CODE_SIZE] = {
@@ -365,33 +468,91 @@ class MPU6050Driver {
         return 0;
     }
 
-    bool dmpGetCurrentFIFOPacket(uint8_t* data) {
-        int16_t fifoC = getFIFOCount();
-
-        if (fifoC > 200) {
+    // One FIFO count read and one burst read of every whole packet queued.
+    bool drainFIFO(int64_t newest_time) {
+        const uint16_t packet_size = _mode == Mode::RAW ? RAW_PACKET_SIZE : DMP_PACKET_SIZE;
+        const uint16_t max_packets = _mode == Mode::RAW ? RAW_MAX_BURST_PACKETS : DMP_MAX_BURST_PACKETS;
+        const uint16_t fifoC = getFIFOCount();
+        if (fifoC > max_packets * packet_size) {
             resetFIFO();
-            uint32_t start = xTaskGetTickCount();
-            fifoC = 0;
-            while (!fifoC && (xTaskGetTickCount() - start) < pdMS_TO_TICKS(100)) {
-                vTaskDelay(pdMS_TO_TICKS(2));
-                fifoC = getFIFOCount();
-            }
-        } else if (fifoC > DMP_PACKET_SIZE) {
-            uint8_t trash[32];
-            while ((fifoC = getFIFOCount()) > DMP_PACKET_SIZE) {
-                uint16_t toRemove = fifoC - DMP_PACKET_SIZE;
-                while (toRemove > 0) {
-                    uint8_t chunk = (toRemove < 32) ? toRemove : 32;
-                    I2CBus::instance().readReg(_addr, REG_FIFO_R_W, trash, chunk);
-                    toRemove -= chunk;
-                }
-            }
+            _fifo_resets++;
+            return false;
         }
+        const uint16_t count = fifoC / packet_size;
+        if (!count) return false;
+
+        uint8_t burst[MAX_BURST_BYTES];
+        if (I2CBus::instance().readReg(_addr, REG_FIFO_R_W, burst, count * packet_size) != ESP_OK) return false;
+        ingestPackets(burst, count, newest_time);
+        return true;
+    }
+
+    void rawInitialize() {
+        writeBit(REG_PWR_MGMT_1, 7, 1);
+        vTaskDelay(pdMS_TO_TICKS(100));
 
-        if (!fifoC) return false;
-        if (fifoC != DMP_PACKET_SIZE) return false;
+        writeReg(REG_PWR_MGMT_1, 0x01);   // PLL on gyro X
+        writeReg(REG_CONFIG, 0x01);       // 188 Hz DLPF, 1 kHz gyro output
+        writeReg(REG_SMPLRT_DIV, 0x00);   // sample at the full 1 kHz
+        writeReg(REG_GYRO_CONFIG, 0x08);  // +-500 dps
+        writeReg(REG_ACCEL_CONFIG, 0x00); // +-2 g
+        writeReg(REG_INT_ENABLE, 0x00);
+        writeReg(REG_USER_CTRL, 0x04); // FIFO reset
+        writeReg(REG_USER_CTRL, 0x40); // FIFO enable
+        writeReg(REG_FIFO_EN, 0x78);   // accel + gyro xyz
+        _fusion.reset();
+    }
 
-        I2CBus::instance().readReg(_addr, REG_FIFO_R_W, data, DMP_PACKET_SIZE);
+    void fuseRawSample(const uint8_t* packet) {
+        using S = Fusion::Scalar;
+        constexpr S accel_scale(ACCEL_G_PER_LSB), gyro_scale(GYRO_RAD_PER_LSB);
+        constexpr S dt(RAW_SAMPLE_PERIOD_US * 1e-6f);
+        int16_t raw[6];
+        for (int i = 0; i < 6; i++) raw[i] = static_cast<int16_t>((packet[2 * i] << 8) | packet[2 * i + 1]);
+        _fusion.update(gyro_scale * raw[3], gyro_scale * raw[4], gyro_scale * raw[5], accel_scale * raw[0],
+                       accel_scale * raw[1], accel_scale * raw[2], dt);
+    }
+
+    bool attachInterrupt(int pin) {
+        const auto gpio = static_cast<gpio_num_t>(pin);
+        esp_err_t err = gpio_install_isr_service(0);
+        if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) return false;
+        gpio_reset_pin(gpio);
+        gpio_set_direction(gpio, GPIO_MODE_INPUT);
+        // INT_PIN_CFG is 0x82: active low push-pull, 50 us pulse per DMP packet.
+        gpio_set_intr_type(gpio, GPIO_INTR_NEGEDGE);
+        if (gpio_isr_handler_add(gpio, dataReadyIsr, this) != ESP_OK) return false;
+        _int_pin = pin;
+        return true;
+    }
+
+    // Bumps the sequence to odd while the 64-bit time is written so readers on the other core never see it torn.
+    static void IRAM_ATTR dataReadyIsr(void* arg) {
+        auto* self = static_cast<MPU6050Driver*>(arg);
+        self->_int_sequence.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        self->_int_time = esp_timer_get_time();
+        self->_int_sequence.fetch_add(1, std::memory_order_release);
+        if (self->_reader) {
+            BaseType_t woken = pdFALSE;
+            vTaskNotifyGiveFromISR(self->_reader, &woken);
+            portYIELD_FROM_ISR(woken);
+        }
+    }
+
+    // True if an interrupt arrived since the last call; `time` gets the newest one.
+    bool latestInterrupt(int64_t& time) {
+        uint32_t before, after;
+        int64_t stamp;
+        do {
+            before = _int_sequence.load(std::memory_order_acquire);
+            stamp = _int_time;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = _int_sequence.load(std::memory_order_relaxed);
+        } while (before != after || (before & 1));
+        if (before == _int_seen) return false;
+        _int_seen = before;
+        time = stamp;
         return true;
     }
 
@@ -500,8 +661,21 @@ class MPU6050Driver {
 
     uint8_t _addr;
     bool _initialized = false;
-    uint8_t _fifoBuffer[DMP_PACKET_SIZE];
     float _gravity[3] = {0};
     float _rpy[3] = {0};
     float _temp = 0;
+    int64_t _temp_time = 0;
+
+    Mode _mode;
+    Fusion _fusion;
+
+    RingBuffer<imu_packet_t, PACKET_RING> _packets;
+    int64_t _sample_period_us; // refined from packet arrival times in DMP mode
+    uint32_t _fifo_resets = 0;
+
+    int _int_pin = -1;
+    TaskHandle_t _reader = nullptr;
+    std::atomic<uint32_t> _int_sequence {0};
+    volatile int64_t _int_time = 0;
+    uint32_t _int_seen = 0;
 };
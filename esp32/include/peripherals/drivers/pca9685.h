@@ -1,11 +1,15 @@
 #pragma once
 
 #include <peripherals/i2c_bus.h>
+#include <esp_timer.h>
 #include <algorithm>
+#include <cstring>
 
 class PCA9685Driver {
   public:
     static constexpr uint8_t DEFAULT_ADDR = 0x40;
+    // updatePWM() rewrites the whole frame at least this often, so a glitched or reset chip converges.
+    static constexpr int64_t FULL_REFRESH_US = 1000000;
 
     PCA9685Driver(uint8_t addr = DEFAULT_ADDR) : _addr(addr) {}
 
@@ -23,6 +27,7 @@ class PCA9685Driver {
     void reset() {
         writeReg(REG_MODE1, MODE1_RESTART);
         vTaskDelay(pdMS_TO_TICKS(10));
+        _synced = 0;
     }
 
     void sleep() {
@@ -62,32 +67,53 @@ class PCA9685Driver {
 
         uint8_t buf[4] = {static_cast<uint8_t>(on & 0xFF), static_cast<uint8_t>(on >> 8),
                           static_cast<uint8_t>(off & 0xFF), static_cast<uint8_t>(off >> 8)};
+        _synced &= ~(1u << channel);
         return I2CBus::instance().writeReg(_addr, REG_LED0_ON_L + 4 * channel, buf, 4) == ESP_OK ? 0 : 1;
     }
 
     uint8_t setMultiplePWM(const uint16_t* values, uint8_t length) {
         if (length > 16) length = 16;
 
-        uint8_t buf[64];
+        for (uint8_t i = 0; i < length; i++) encode(values[i], &_frame[i * 4]);
+        return writeRun(0, length);
+    }
+
+    /*
+     * Like setMultiplePWM, but only channels whose value differs from the last one written go out, one transaction
+     * per contiguous run of changed channels. Nothing is sent when no channel changed. The full frame is rewritten
+     * when channels are out of sync or FULL_REFRESH_US has passed since the last full write.
+     */
+    uint8_t updatePWM(const uint16_t* values, uint8_t length, int64_t now = esp_timer_get_time()) {
+        if (length > 16) length = 16;
+        const uint16_t all = (1u << length) - 1;
+        if ((_synced & all) != all || now - _last_full >= FULL_REFRESH_US) {
+            _last_full = now;
+            return setMultiplePWM(values, length);
+        }
+
+        uint16_t changed = 0;
         for (uint8_t i = 0; i < length; i++) {
-            uint16_t val = values[i] > 4095 ? 4095 : values[i];
-            uint8_t* b = &buf[i * 4];
-            b[0] = 0;
-            if (val == 0) {
-                b[1] = 0;
-                b[2] = 0;
-                b[3] = FULL_OFF_BIT;
-            } else if (val == 4095) {
-                b[1] = FULL_ON_BIT;
-                b[2] = 0;
-                b[3] = 0;
-            } else {
-                b[1] = 0;
-                b[2] = val & 0xFF;
-                b[3] = val >> 8;
+            uint8_t b[4];
+            encode(values[i], b);
+            if (memcmp(b, &_frame[i * 4], 4) == 0) continue;
+            memcpy(&_frame[i * 4], b, 4);
+            changed |= 1u << i;
+        }
+
+        uint8_t result = 0;
+        uint8_t i = 0;
+        while (i < length) {
+            if (!(changed & (1u << i))) {
+                i++;
+                continue;
             }
+            uint8_t last = i;
+            for (uint8_t j = i + 1; j < length && j - last <= MERGE_GAP + 1; j++)
+                if (changed & (1u << j)) last = j;
+            result |= writeRun(i, last + 1 - i);
+            i = last + 1;
         }
-        return I2CBus::instance().writeReg(_addr, REG_LED0_ON_L, buf, length * 4) == ESP_OK ? 0 : 1;
+        return result;
     }
 
     bool isInitialized() const { return _initialized; }
@@ -105,6 +131,39 @@ class PCA9685Driver {
     static constexpr uint8_t FULL_ON_BIT = 0x10;
     static constexpr uint8_t FULL_OFF_BIT = 0x10;
 
+    // Unchanged channels bridged within one run. At 100-400 kHz resending a channel's four bytes takes at least as
+    // long as the address, register and start/stop of a separate transaction, so runs are not bridged by default.
+    static constexpr uint8_t MERGE_GAP = 0;
+
+    static void encode(uint16_t value, uint8_t* b) {
+        uint16_t val = value > 4095 ? 4095 : value;
+        b[0] = 0;
+        if (val == 0) {
+            b[1] = 0;
+            b[2] = 0;
+            b[3] = FULL_OFF_BIT;
+        } else if (val == 4095) {
+            b[1] = FULL_ON_BIT;
+            b[2] = 0;
+            b[3] = 0;
+        } else {
+            b[1] = 0;
+            b[2] = val & 0xFF;
+            b[3] = val >> 8;
+        }
+    }
+
+    // Sends channels [first, first + count) from the frame. A failed write leaves them out of sync.
+    uint8_t writeRun(uint8_t first, uint8_t count) {
+        const uint16_t mask = ((1u << count) - 1) << first;
+        if (I2CBus::instance().writeReg(_addr, REG_LED0_ON_L + 4 * first, &_frame[first * 4], count * 4) != ESP_OK) {
+            _synced &= ~mask;
+            return 1;
+        }
+        _synced |= mask;
+        return 0;
+    }
+
     void writeReg(uint8_t reg, uint8_t val) { I2CBus::instance().writeReg(_addr, reg, &val, 1); }
 
     uint8_t readReg(uint8_t reg) {
@@ -116,4 +175,8 @@ class PCA9685Driver {
     uint8_t _addr;
     bool _initialized = false;
     uint32_t _oscFreq = 25000000;
+
+    uint8_t _frame[64] = {}; // last value written per channel, register encoded
+    uint16_t _synced = 0;    // channels whose _frame matches the chip
+    int64_t _last_full = 0;
 };
@@ -2,12 +2,60 @@
 
 #include <driver/i2c_master.h>
 #include <esp_log.h>
+#include <esp_timer.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <utils/trace.h>
 #include <functional>
 #include <vector>
 #include <cstring>
 
+// Lower value runs first when queued transactions compete for the bus.
+enum class I2CPriority : uint8_t { SERVO = 0, CONTROL = 1, SENSOR = 2, BACKGROUND = 3 };
+
+struct i2c_device_stats_t {
+    uint8_t address {0};
+    uint32_t transactions {0};
+    uint32_t errors {0};
+    uint32_t expired {0}; // queued transactions dropped at their deadline
+    uint32_t bytes_written {0};
+    uint32_t bytes_read {0};
+    // Request to completion, including waiting for the bus or the queue.
+    uint64_t total_latency_us {0};
+    uint32_t max_latency_us {0};
+};
+
+/*
+ * Asynchronous transfer: `write` is sent first (register address and payload, copied on submit), then `read_len`
+ * bytes are read into `read` if set. `done` runs on the bus worker once the transfer finished, failed, or was
+ * dropped with ESP_ERR_TIMEOUT because it had not started by `deadline` (esp_timer us, 0 for none); `read` must stay
+ * valid until then.
+ */
+struct i2c_transaction_t {
+    static constexpr size_t MAX_WRITE = 68; // register + a full 16 channel PCA9685 frame
+
+    uint8_t addr {0};
+    I2CPriority priority {I2CPriority::SENSOR};
+    uint8_t write_len {0};
+    uint8_t write[MAX_WRITE];
+    uint8_t *read {nullptr};
+    size_t read_len {0};
+    int64_t deadline {0};
+    void (*done)(esp_err_t err, void *ctx) {nullptr};
+    void *ctx {nullptr};
+};
+
+/*
+ * Shared I2C master. Every address keeps its own device handle for the lifetime of the bus, so alternating between
+ * devices costs nothing, and each device accumulates transfer statistics.
+ *
+ * Synchronous calls (writeReg, readReg, ...) hold the bus for one transfer; waiters are served in task priority
+ * order, so the control task's servo writes go ahead of the sensor task. Transfers that need not block their caller
+ * can be submit()ted instead: the queue is served highest priority first, earliest deadline within a priority, by a
+ * worker task (startWorker) or by whoever calls runPending(). The worker runs below the sensor task, so slow sensors
+ * queued there (the barometer) go last and hold up a servo frame by one transfer at most.
+ */
 class I2CBus {
   public:
     static I2CBus& instance() {
@@ -49,11 +97,9 @@ class I2CBus {
 
     void end() {
         if (_initialized) {
-            if (_dev) {
-                i2c_master_bus_rm_device(_dev);
-                _dev = NULL;
-                _dev_addr = 0xFF;
-            }
+            BusLock lock(_lock);
+            for (size_t i = 0; i < _device_count; i++) i2c_master_bus_rm_device(_devices[i].handle);
+            _device_count = 0;
             i2c_del_master_bus(_bus);
             _bus = NULL;
             _initialized = false;
@@ -66,33 +112,93 @@ class I2CBus {
 
     esp_err_t writeBytes(uint8_t addr, const uint8_t* data, size_t len) {
         if (!_initialized) return ESP_ERR_INVALID_STATE;
-        esp_err_t err = ensureDevice(addr);
-        if (err != ESP_OK) return err;
-        return i2c_master_transmit(_dev, data, len, pdMS_TO_TICKS(200));
+        const int64_t start = esp_timer_get_time();
+        BusLock lock(_lock);
+        return transfer(addr, data, len, nullptr, 0, start);
     }
 
     esp_err_t writeReg(uint8_t addr, uint8_t reg, const uint8_t* data, size_t len) {
         if (!_initialized) return ESP_ERR_INVALID_STATE;
-        esp_err_t err = ensureDevice(addr);
-        if (err != ESP_OK) return err;
+        const int64_t start = esp_timer_get_time();
 
         uint8_t buf[len + 1];
         buf[0] = reg;
         if (len > 0 && data != nullptr) {
             memcpy(buf + 1, data, len);
         }
-        return i2c_master_transmit(_dev, buf, len + 1, pdMS_TO_TICKS(200));
+        BusLock lock(_lock);
+        return transfer(addr, buf, len + 1, nullptr, 0, start);
     }
 
     esp_err_t readReg(uint8_t addr, uint8_t reg, uint8_t* data, size_t len) {
         if (!_initialized) return ESP_ERR_INVALID_STATE;
-        esp_err_t err = ensureDevice(addr);
-        if (err != ESP_OK) return err;
-        return i2c_master_transmit_receive(_dev, &reg, 1, data, len, pdMS_TO_TICKS(200));
+        const int64_t start = esp_timer_get_time();
+        BusLock lock(_lock);
+        return transfer(addr, &reg, 1, data, len, start);
+    }
+
+    // Queues a transaction. Returns ESP_ERR_NO_MEM when the queue is full; `done` is not called then.
+    esp_err_t submit(const i2c_transaction_t& transaction) {
+        if (!_initialized) return ESP_ERR_INVALID_STATE;
+        if (transaction.write_len > i2c_transaction_t::MAX_WRITE) return ESP_ERR_INVALID_ARG;
+        {
+            BusLock lock(_queue_lock);
+            if (_queued == QUEUE_DEPTH) return ESP_ERR_NO_MEM;
+            _queue[_queued] = {transaction, esp_timer_get_time()};
+            _queued++;
+        }
+        if (_worker) xTaskNotifyGive(_worker);
+        return ESP_OK;
+    }
+
+    /*
+     * Runs queued transactions until the queue is empty. The bus is released between transactions so synchronous
+     * callers wait for at most one queued transfer.
+     */
+    void runPending(int64_t now = esp_timer_get_time()) {
+        pending_t next;
+        while (popNext(next)) {
+            const i2c_transaction_t& t = next.transaction;
+            esp_err_t err;
+            if (!_initialized) {
+                err = ESP_ERR_INVALID_STATE;
+            } else if (t.deadline && now > t.deadline) {
+                err = ESP_ERR_TIMEOUT;
+                BusLock lock(_lock);
+                if (device_slot_t* slot = device(t.addr)) slot->stats.expired++;
+            } else {
+                BusLock lock(_lock);
+                err = transfer(t.addr, t.write, t.write_len, t.read, t.read_len, next.submitted);
+            }
+            if (t.done) t.done(err, t.ctx);
+            now = esp_timer_get_time();
+        }
+    }
+
+    // Serves the queue from its own task. Without a worker, queued transactions wait for runPending().
+    void startWorker(BaseType_t core = 0, UBaseType_t priority = 5) {
+        if (_worker) return;
+        xTaskCreatePinnedToCore(workerEntry, "I2C worker", 3072, this, priority, &_worker, core);
+    }
+
+    bool hasWorker() const { return _worker != nullptr; }
+
+    // Copies up to `max` device statistics into `out`, returns the number of devices.
+    size_t deviceStats(i2c_device_stats_t* out, size_t max) {
+        BusLock lock(_lock);
+        size_t n = 0;
+        for (; n < _device_count && n < max; n++) out[n] = _devices[n].stats;
+        return n;
+    }
+
+    void resetStats() {
+        BusLock lock(_lock);
+        for (size_t i = 0; i < _device_count; i++) _devices[i].stats = {_devices[i].stats.address};
     }
 
     bool probe(uint8_t addr) {
         if (!_initialized) return false;
+        BusLock lock(_lock);
         return i2c_master_probe(_bus, addr, pdMS_TO_TICKS(200)) == ESP_OK;
     }
 
@@ -116,12 +222,33 @@ class I2CBus {
     uint32_t freq() const { return _freq; }
 
   private:
-    I2CBus() = default;
+    I2CBus() : _lock(xSemaphoreCreateMutex()), _queue_lock(xSemaphoreCreateMutex()) {}
     ~I2CBus() { end(); }
     I2CBus(const I2CBus&) = delete;
     I2CBus& operator=(const I2CBus&) = delete;
 
     static constexpr const char* TAG = "I2CBus";
+    static constexpr size_t MAX_DEVICES = 16;
+    static constexpr size_t QUEUE_DEPTH = 16;
+
+    struct device_slot_t {
+        i2c_master_dev_handle_t handle;
+        i2c_device_stats_t stats;
+    };
+
+    struct pending_t {
+        i2c_transaction_t transaction;
+        int64_t submitted;
+    };
+
+    // Transfers come from the control task (servos), the sensor task and the worker.
+    struct BusLock {
+        SemaphoreHandle_t sem;
+        explicit BusLock(SemaphoreHandle_t sem) : sem(sem) { xSemaphoreTake(sem, portMAX_DELAY); }
+        ~BusLock() { xSemaphoreGive(sem); }
+    };
+    SemaphoreHandle_t _lock;       // bus and device table
+    SemaphoreHandle_t _queue_lock; // transaction queue only, never held across a transfer
     i2c_port_t _port = I2C_NUM_0;
     gpio_num_t _sda = GPIO_NUM_NC;
     gpio_num_t _scl = GPIO_NUM_NC;
@@ -129,21 +256,81 @@ class I2CBus {
     bool _initialized = false;
 
     i2c_master_bus_handle_t _bus = NULL;
-    i2c_master_dev_handle_t _dev = NULL;
-    uint8_t _dev_addr = 0xFF;
-
-    esp_err_t ensureDevice(uint8_t addr) {
-        if (_dev && _dev_addr == addr) return ESP_OK;
-        if (_dev) {
-            i2c_master_bus_rm_device(_dev);
-            _dev = NULL;
+    device_slot_t _devices[MAX_DEVICES];
+    size_t _device_count = 0;
+
+    pending_t _queue[QUEUE_DEPTH];
+    size_t _queued = 0;
+    TaskHandle_t _worker = nullptr;
+
+    static void workerEntry(void* arg) {
+        auto* self = static_cast<I2CBus*>(arg);
+        for (;;) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            self->runPending();
+        }
+    }
+
+    // Takes the highest priority, earliest deadline transaction off the queue. A linear scan, the queue is tiny.
+    bool popNext(pending_t& out) {
+        BusLock lock(_queue_lock);
+        if (!_queued) return false;
+        size_t best = 0;
+        for (size_t i = 1; i < _queued; i++) {
+            const i2c_transaction_t& a = _queue[i].transaction;
+            const i2c_transaction_t& b = _queue[best].transaction;
+            if (a.priority != b.priority) {
+                if (a.priority < b.priority) best = i;
+            } else if (a.deadline && (!b.deadline || a.deadline < b.deadline)) {
+                best = i;
+            }
+        }
+        out = _queue[best];
+        // Keep submission order among equals by shifting rather than swapping the tail in.
+        for (size_t i = best + 1; i < _queued; i++) _queue[i - 1] = _queue[i];
+        _queued--;
+        return true;
+    }
+
+    // Looks up or creates the handle for `addr`. Caller holds _lock.
+    device_slot_t* device(uint8_t addr) {
+        for (size_t i = 0; i < _device_count; i++)
+            if (_devices[i].stats.address == addr) return &_devices[i];
+        if (_device_count == MAX_DEVICES) {
+            ESP_LOGE(TAG, "Device table full, cannot add 0x%02X", addr);
+            return nullptr;
         }
         i2c_device_config_t dev_cfg = {};
         dev_cfg.dev_addr_length = I2C_ADDR_BIT_LEN_7;
         dev_cfg.device_address = addr;
         dev_cfg.scl_speed_hz = _freq;
-        esp_err_t err = i2c_master_bus_add_device(_bus, &dev_cfg, &_dev);
-        if (err == ESP_OK) _dev_addr = addr;
+        device_slot_t& slot = _devices[_device_count];
+        if (i2c_master_bus_add_device(_bus, &dev_cfg, &slot.handle) != ESP_OK) return nullptr;
+        slot.stats = {addr};
+        _device_count++;
+        return &slot;
+    }
+
+    // One transfer on `addr`'s handle, accounted to its statistics. Caller holds _lock.
+    esp_err_t transfer(uint8_t addr, const uint8_t* write, size_t write_len, uint8_t* read, size_t read_len,
+                       int64_t requested) {
+        TRACE_SCOPE_VALUE("i2c", addr);
+        device_slot_t* slot = device(addr);
+        if (!slot) return ESP_FAIL;
+        esp_err_t err = read ? i2c_master_transmit_receive(slot->handle, write, write_len, read, read_len,
+                                                           pdMS_TO_TICKS(200))
+                             : i2c_master_transmit(slot->handle, write, write_len, pdMS_TO_TICKS(200));
+        i2c_device_stats_t& stats = slot->stats;
+        const uint32_t latency = static_cast<uint32_t>(esp_timer_get_time() - requested);
+        stats.transactions++;
+        stats.total_latency_us += latency;
+        if (latency > stats.max_latency_us) stats.max_latency_us = latency;
+        if (err != ESP_OK) {
+            stats.errors++;
+        } else {
+            stats.bytes_written += write_len;
+            if (read) stats.bytes_read += read_len;
+        }
         return err;
     }
 };
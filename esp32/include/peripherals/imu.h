@@ -2,12 +2,23 @@
 
 #include <utils/math_utils.h>
 #include <features.h>
+#include <esp_timer.h>
 #include <peripherals/sensor.hpp>
 
 #if FT_ENABLED(USE_MPU6050)
 #include <peripherals/drivers/mpu6050.h>
 #endif
 
+#ifndef IMU_RAW_FUSION
+// MPU6050: fuse raw 1 kHz accel + gyro on the MCU instead of running the DMP firmware.
+#define IMU_RAW_FUSION 0
+#endif
+
+#ifndef IMU_INT_PIN
+// MPU6050 INT output; -1 polls the FIFO instead.
+#define IMU_INT_PIN -1
+#endif
+
 #if FT_ENABLED(USE_BNO055)
 #include <peripherals/drivers/bno055.h>
 #endif
@@ -15,6 +26,7 @@
 struct IMUAnglesMsg {
     float rpy[3] {0, 0, 0};
     float temperature {-1};
+    int64_t time {0}; // esp_timer time (us) of the sample
     bool success {false};
 };
 
@@ -22,7 +34,7 @@ class IMU : public SensorBase<IMUAnglesMsg> {
   public:
     bool initialize() override {
 #if FT_ENABLED(USE_MPU6050)
-        _msg.success = _imu.begin();
+        _msg.success = _imu.begin(IMU_INT_PIN);
         if (!_msg.success) {
             ESP_LOGE("IMU", "MPU6050 initialization failed");
             return false;
@@ -48,20 +60,40 @@ class IMU : public SensorBase<IMUAnglesMsg> {
         _msg.rpy[1] = _imu.getPitch();
         _msg.rpy[2] = _imu.getRoll();
         _msg.temperature = _imu.getTemperature();
+        _msg.time = _imu.getSampleTime();
 #endif
 #if FT_ENABLED(USE_BNO055)
         if (!_imu.update()) return false;
-        _msg.rpy[0] = _imu.getHeading();
-        _msg.rpy[1] = _imu.getPitch();
-        _msg.rpy[2] = _imu.getRoll();
+        // The BNO055 reports degrees; IMU angles are radians whichever driver is fitted.
+        _msg.rpy[0] = DEG_TO_RAD_F(_imu.getHeading());
+        _msg.rpy[1] = DEG_TO_RAD_F(_imu.getPitch());
+        _msg.rpy[2] = DEG_TO_RAD_F(_imu.getRoll());
+        _msg.time = esp_timer_get_time();
 #endif
         return true;
     }
 
     float getTemperature() { return _msg.temperature; }
+    // Radians.
     float getAngleX() { return _msg.rpy[2]; }
     float getAngleY() { return _msg.rpy[1]; }
     float getAngleZ() { return _msg.rpy[0]; }
+    int64_t getSampleTime() { return _msg.time; }
+
+    // True when the IMU signals new data itself, so it can be read on every wake instead of on a schedule.
+    bool isInterruptDriven() {
+#if FT_ENABLED(USE_MPU6050)
+        return _imu.isInterruptDriven();
+#else
+        return false;
+#endif
+    }
+
+    void setReader([[maybe_unused]] TaskHandle_t reader) {
+#if FT_ENABLED(USE_MPU6050)
+        _imu.setReader(reader);
+#endif
+    }
 
     bool calibrate() {
 #if FT_ENABLED(USE_MPU6050)
@@ -83,7 +115,8 @@ class IMU : public SensorBase<IMUAnglesMsg> {
 
   private:
 #if FT_ENABLED(USE_MPU6050)
-    MPU6050Driver _imu;
+    MPU6050Driver _imu {MPU6050Driver::DEFAULT_ADDR,
+                        IMU_RAW_FUSION ? MPU6050Driver::Mode::RAW : MPU6050Driver::Mode::DMP};
 #endif
 #if FT_ENABLED(USE_BNO055)
     BNO055Driver _imu;
@@ -5,6 +5,7 @@
 #include <template/stateful_proto_endpoint.h>
 #include <utils/math_utils.h>
 #include <utils/timing.h>
+#include <utils/mailbox.h>
 #include <filesystem.h>
 #include <features.h>
 #include <settings/peripherals_settings.h>
@@ -12,28 +13,76 @@
 
 #include <list>
 
-#if FT_ENABLED(USE_USS)
-#include <NewPing.h>
-#endif
 #include <peripherals/i2c_bus.h>
 #include <peripherals/imu.h>
 #include <peripherals/magnetometer.h>
 #include <peripherals/barometer.h>
 #include <peripherals/gesture.h>
+#include <peripherals/sonar.h>
+#if FT_ENABLED(USE_USS)
+#include <peripherals/drivers/hcsr04.h>
+#endif
 
 /*
  * Ultrasonic Sensor Settings
  */
 #define MAX_DISTANCE 200
 
+// -1 disables a side. The echo pin defaults to the trigger pin for one-wire wiring.
+#ifndef USS_LEFT_PIN
+#define USS_LEFT_PIN -1
+#endif
+#ifndef USS_LEFT_ECHO_PIN
+#define USS_LEFT_ECHO_PIN USS_LEFT_PIN
+#endif
+#ifndef USS_RIGHT_PIN
+#define USS_RIGHT_PIN -1
+#endif
+#ifndef USS_RIGHT_ECHO_PIN
+#define USS_RIGHT_ECHO_PIN USS_RIGHT_PIN
+#endif
+
+#define SENSOR_TASK_PERIOD_MS 10
+
+/*
+ * Latest reading of every sensor, published by the sensor task. Each group carries the esp_timer time (us) of the
+ * sample that produced it, 0 until the first successful read.
+ */
+struct sensor_snapshot_t {
+    int64_t imu_time {0};
+    float angles[3] {0, 0, 0}; // x, y, z in radians
+
+    int64_t mag_time {0};
+    float heading {0};
+
+    int64_t bmp_time {0};
+    float altitude {0};
+    float temperature {0};
+    float pressure {0};
+
+    // Median filtered, stamped with the time of each side's newest ping.
+    sonar_reading_t left_sonar {MAX_DISTANCE, 0};
+    sonar_reading_t right_sonar {MAX_DISTANCE, 0};
+
+    // gesture_count increments for every detected gesture, so a reader can tell a new one from a repeat.
+    gesture_t gesture {eGestureNone};
+    uint32_t gesture_count {0};
+};
+
 class Peripherals : public StatefulService<PeripheralsConfiguration> {
   public:
     Peripherals();
 
     void begin();
 
+    // Runs the sensor reads on their own task; until then update() reads the sensors inline.
+    void startSensorTask(BaseType_t core = 0, UBaseType_t priority = 4);
+
+    // Control loop side: picks up the newest snapshot from the sensor task. Constant time, never blocks.
     void update();
 
+    const sensor_snapshot_t &snapshot() const { return _snapshot; }
+
     void updatePins();
 
     void scanI2C(uint8_t lower = 1, uint8_t higher = 127);
@@ -51,7 +100,7 @@ class Peripherals : public StatefulService<PeripheralsConfiguration> {
 
     bool readGesture();
 
-    void readSonar();
+    bool readSonar();
 
     float angleX();
 
@@ -61,8 +110,8 @@ class Peripherals : public StatefulService<PeripheralsConfiguration> {
 
     gesture_t takeGesture();
 
-    float leftDistance();
-    float rightDistance();
+    sonar_reading_t leftDistance();
+    sonar_reading_t rightDistance();
 
     bool calibrateIMU();
 
@@ -89,11 +138,18 @@ class Peripherals : public StatefulService<PeripheralsConfiguration> {
     GestureSensor _gesture;
 #endif
 #if FT_ENABLED(USE_USS)
-    std::unique_ptr<NewPing> _left_sonar;
-    std::unique_ptr<NewPing> _right_sonar;
+    SonarPair<HCSR04Driver> _sonar;
 #endif
-    float _left_distance {MAX_DISTANCE};
-    float _right_distance {MAX_DISTANCE};
+
+    static void sensorTaskEntry(void *arg);
+    void acquire();
+
+    TaskHandle_t _sensor_task {nullptr};
+    sensor_snapshot_t _acquired;           // sensor task owned
+    Mailbox<sensor_snapshot_t> _snapshots; // sensor task -> control loop
+    sensor_snapshot_t _snapshot;           // control loop owned
+    sensor_snapshot_t _published;          // under _accessMutex, for readers off the control loop
+    uint32_t _gestures_taken {0};
 
     std::list<uint8_t> _address_list;
     bool _i2c_active = false;
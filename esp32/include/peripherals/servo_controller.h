@@ -2,6 +2,7 @@
 #define ServoController_h
 
 #include <peripherals/drivers/pca9685.h>
+#include <peripherals/servo_pwm_table.h>
 #include <template/stateful_persistence.h>
 #include <template/stateful_proto_endpoint.h>
 #include <template/stateful_service.h>
@@ -23,11 +24,14 @@ using ServoSettings = api_ServoSettings;
 inline ServoSettings ServoSettings_defaults() {
     ServoSettings settings = {};
     settings.servos_count = 12;
+    // No calibration points: the linear terms apply until the servos are calibrated.
     const api_Servo defaults[12] = {
-        {306, -1, 0, 2.0f, "Servo1"}, {306, 1, -45, 2.0f, "Servo2"},  {306, 1, 90, 2.0f, "Servo3"},
-        {306, -1, 0, 2.0f, "Servo4"}, {306, -1, 45, 2.0f, "Servo5"},  {306, -1, -90, 2.0f, "Servo6"},
-        {306, 1, 0, 2.0f, "Servo7"},  {306, 1, -45, 2.0f, "Servo8"},  {306, 1, 90, 2.0f, "Servo9"},
-        {306, 1, 0, 2.0f, "Servo10"}, {306, -1, 45, 2.0f, "Servo11"}, {306, -1, -90, 2.0f, "Servo12"}};
+        {306, -1, 0, 2.0f, "Servo1", 0, {}},   {306, 1, -45, 2.0f, "Servo2", 0, {}},
+        {306, 1, 90, 2.0f, "Servo3", 0, {}},   {306, -1, 0, 2.0f, "Servo4", 0, {}},
+        {306, -1, 45, 2.0f, "Servo5", 0, {}},  {306, -1, -90, 2.0f, "Servo6", 0, {}},
+        {306, 1, 0, 2.0f, "Servo7", 0, {}},    {306, 1, -45, 2.0f, "Servo8", 0, {}},
+        {306, 1, 90, 2.0f, "Servo9", 0, {}},   {306, 1, 0, 2.0f, "Servo10", 0, {}},
+        {306, -1, 45, 2.0f, "Servo11", 0, {}}, {306, -1, -90, 2.0f, "Servo12", 0, {}}};
     for (int i = 0; i < 12; i++) {
         settings.servos[i] = defaults[i];
     }
@@ -48,10 +52,13 @@ class ServoController : public StatefulService<ServoSettings> {
                         API_REQUEST_EXTRACTOR(servo_settings, ServoSettings),
                         API_RESPONSE_ASSIGNER(servo_settings, ServoSettings)),
           _persistence(ServoSettings_read, ServoSettings_update, this, SERVO_SETTINGS_FILE, api_ServoSettings_fields,
-                       api_ServoSettings_size, ServoSettings_defaults()) {}
+                       api_ServoSettings_size, ServoSettings_defaults()) {
+        addUpdateHandler([&](const std::string &originId) { _table.rebuild(state()); }, false);
+    }
 
     void begin() {
         _persistence.readFromFS();
+        _table.rebuild(state());
         initializePCA();
     }
 
@@ -82,35 +89,76 @@ class ServoController : public StatefulService<ServoSettings> {
         if (servo_id < 0) {
             uint16_t pwms[12];
             std::fill_n(pwms, 12, static_cast<uint16_t>(pwm));
+            std::fill_n(manual_pwms, 12, static_cast<uint16_t>(pwm));
             _pca.setMultiplePWM(pwms, 12);
         } else {
+            if (servo_id < 12) manual_pwms[servo_id] = pwm;
             _pca.setPWM(servo_id, 0, pwm);
         }
         ESP_LOGI("SERVO_CONTROLLER", "Setting servo %d to %d", servo_id, pwm);
     }
 
+    /*
+     * Calibration capture: with a servo jogged through setServoPWM until its joint sits at a measured angle, stores
+     * that PWM as the curve point for the angle, replacing any point within half a degree of it. Returns the servo's
+     * point count, or -1 when the servo has no PWM set or its points are full.
+     */
+    int captureCalibrationPoint(int32_t servo_id, float angle) {
+        if (servo_id < 0 || servo_id >= 12 || !manual_pwms[servo_id]) return -1;
+        const float pwm = manual_pwms[servo_id];
+        int count = -1;
+        StatefulService::update(
+            [&](ServoSettings &settings) {
+                api_Servo &servo = settings.servos[servo_id];
+                auto *end = servo.points + servo.points_count;
+                auto *point =
+                    std::find_if(servo.points, end, [&](const auto &p) { return fabsf(p.angle - angle) < 0.5f; });
+                if (point == end) {
+                    if (servo.points_count >= MAX_CALIBRATION_POINTS) return StateUpdateResult::ERROR;
+                    servo.points_count++;
+                }
+                *point = {angle, pwm};
+                count = servo.points_count;
+                return StateUpdateResult::CHANGED;
+            },
+            "calibration");
+        ESP_LOGI("SERVO_CONTROLLER", "Servo %d calibrated at %.1f deg to %.0f, %d points", servo_id, angle, pwm, count);
+        return count;
+    }
+
+    // Drops a servo's calibration points, returning it to the linear terms.
+    int clearCalibration(int32_t servo_id) {
+        if (servo_id < 0 || servo_id >= 12) return -1;
+        StatefulService::update(
+            [&](ServoSettings &settings) {
+                if (!settings.servos[servo_id].points_count) return StateUpdateResult::UNCHANGED;
+                settings.servos[servo_id].points_count = 0;
+                return StateUpdateResult::CHANGED;
+            },
+            "calibration");
+        return 0;
+    }
+
     void updateActiveState() { is_active ? activate() : deactivate(); }
 
     void setMode(SERVO_CONTROL_STATE newMode) { control_state = newMode; }
 
     void setAngles(float new_angles[12]) {
         for (int i = 0; i < 12; i++) {
-            target_angles[i] = new_angles[i];
+            angles[i] = servo_angle_t(new_angles[i]);
         }
     }
 
     void calculatePWM() {
         uint16_t pwms[12];
-        for (int i = 0; i < 12; i++) {
-            angles[i] = lerp(angles[i], target_angles[i], 0.1);
-            auto &servo = state().servos[i];
-            float angle = servo.direction * angles[i] + servo.center_angle;
-            uint16_t pwm = angle * servo.conversion + servo.center_pwm;
-            pwms[i] = pwm = std::clamp<uint16_t>(pwm, 125, 600);
-        }
-        _pca.setMultiplePWM(pwms, 12);
+        _table.step(angles, pwms);
+        _pca.updatePWM(pwms, 12);
     }
 
+    const ServoPWMTable &pwmTable() const { return _table; }
+
+    static constexpr int MAX_CALIBRATION_POINTS = sizeof(api_Servo::points) / sizeof(api_Servo::points[0]);
+
     void update() {
         if (control_state == SERVO_CONTROL_STATE::ANGLE) calculatePWM();
     }
@@ -127,12 +175,15 @@ class ServoController : public StatefulService<ServoSettings> {
     FSPersistencePB<ServoSettings> _persistence;
 
     PCA9685Driver _pca;
+    ServoPWMTable _table;
 
     SERVO_CONTROL_STATE control_state = SERVO_CONTROL_STATE::DEACTIVATED;
 
     bool is_active {false};
-    float angles[12] = {0, 90, -145, 0, 90, -145, 0, 90, -145, 0, 90, -145};
-    float target_angles[12] = {0, 90, -145, 0, 90, -145, 0, 90, -145, 0, 90, -145};
+    // Already trajectory-limited by MotionService, written out as is.
+    servo_angle_t angles[12] = {0, 90, -145, 0, 90, -145, 0, 90, -145, 0, 90, -145};
+    // Last PWM set per servo through setServoPWM, 0 when none; the value a calibration capture records.
+    uint16_t manual_pwms[12] {};
 };
 
 #endif
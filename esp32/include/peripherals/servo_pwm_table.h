@@ -0,0 +1,102 @@
+#pragma once
+
+#include <platform_shared/api.pb.h>
+#include <utils/fixed_point.h>
+
+#include <algorithm>
+#include <cstdint>
+
+// Knot spacing of the compiled calibration curves is 2^SERVO_LUT_STEP_SHIFT degrees.
+#ifndef SERVO_LUT_STEP_SHIFT
+#define SERVO_LUT_STEP_SHIFT 1
+#endif
+
+static constexpr int SERVO_ANGLE_FRACTION = 16;
+
+// Joint angle in degrees, Q16.
+using servo_angle_t = Fixed<SERVO_ANGLE_FRACTION>;
+
+static constexpr int SERVO_PWM_FRACTION = 16;
+
+// PWM ticks, Q16: the compiled calibration tables, interpolated before rounding to whole ticks.
+using pwm_q16_t = Fixed<SERVO_PWM_FRACTION>;
+
+/*
+ * Servo calibration compiled for the output stage. Each api_Servo becomes a dense table of PWM ticks (Q16) at evenly
+ * spaced joint angles over -180..180 degrees: from its calibration points when it has two or more (piecewise linear,
+ * extrapolated along the end segments), otherwise from the linear center_pwm, direction, center_angle and conversion
+ * terms. A tick over the 12 channels is then a table index, one interpolation multiply and a min/max clamp per
+ * channel: no float, no branches and no reads of the settings proto. Angles past the table ends
+ * extrapolate along its first or last interval. Rebuilt only when the servo settings change.
+ */
+class ServoPWMTable {
+  public:
+    static constexpr int CHANNELS = 12;
+    static constexpr int32_t MIN_PWM = 125;
+    static constexpr int32_t MAX_PWM = 600;
+
+    static constexpr int MIN_ANGLE = -180;
+    static constexpr int STEP_SHIFT = SERVO_LUT_STEP_SHIFT;
+    static constexpr int KNOTS = (360 >> STEP_SHIFT) + 1;
+
+    void rebuild(const api_ServoSettings &settings) {
+        for (int i = 0; i < CHANNELS; i++) {
+            pwm_q16_t knots[KNOTS];
+            compile(settings.servos[i], knots);
+            // Built aside and copied per channel, a concurrent tick sees at most one frame with a stale channel.
+            std::copy(knots, knots + KNOTS, _knots[i]);
+        }
+    }
+
+    // Unclamped PWM ticks for a channel at the given joint angle.
+    int32_t ticks(int channel, servo_angle_t angle) const {
+        constexpr int SHIFT = SERVO_ANGLE_FRACTION + STEP_SHIFT;
+        const int32_t pos = angle.raw - (MIN_ANGLE << SERVO_ANGLE_FRACTION);
+        const int32_t k = std::clamp(pos >> SHIFT, int32_t(0), int32_t(KNOTS - 2));
+        // Outside the table frac leaves [0, step) and the end interval extrapolates.
+        const int64_t frac = pos - (k << SHIFT);
+        const pwm_q16_t *knots = _knots[channel];
+        const int32_t delta = knots[k + 1].raw - knots[k].raw;
+        return (knots[k].raw + static_cast<int32_t>((delta * frac) >> SHIFT)) >> SERVO_PWM_FRACTION;
+    }
+
+    // Clamped PWM ticks for every channel.
+    void step(const servo_angle_t *angles, uint16_t *pwms) const {
+        for (int i = 0; i < CHANNELS; i++) {
+            pwms[i] = static_cast<uint16_t>(std::clamp(ticks(i, angles[i]), MIN_PWM, MAX_PWM));
+        }
+    }
+
+  private:
+    static void compile(const api_Servo &servo, pwm_q16_t *knots) {
+        constexpr int MAX_POINTS = sizeof(servo.points) / sizeof(servo.points[0]);
+        // A handful of points at most: inserted in angle order, the first given wins a repeated angle.
+        api_ServoCalibrationPoint points[MAX_POINTS];
+        const int given = std::min<int>(servo.points_count, MAX_POINTS);
+        int count = 0;
+        for (int i = 0; i < given; i++) {
+            const api_ServoCalibrationPoint &point = servo.points[i];
+            int at = count;
+            while (at > 0 && points[at - 1].angle > point.angle) at--;
+            if (at > 0 && points[at - 1].angle == point.angle) continue;
+            for (int j = count; j > at; j--) points[j] = points[j - 1];
+            points[at] = point;
+            count++;
+        }
+
+        int segment = 0;
+        for (int k = 0; k < KNOTS; k++) {
+            const float angle = MIN_ANGLE + (k << STEP_SHIFT);
+            if (count < 2) {
+                knots[k] = pwm_q16_t((servo.direction * angle + servo.center_angle) * servo.conversion +
+                                     servo.center_pwm);
+                continue;
+            }
+            while (segment + 2 < count && angle > points[segment + 1].angle) segment++;
+            const auto &a = points[segment], &b = points[segment + 1];
+            knots[k] = pwm_q16_t(a.pwm + (b.pwm - a.pwm) * (angle - a.angle) / (b.angle - a.angle));
+        }
+    }
+
+    pwm_q16_t _knots[CHANNELS][KNOTS] {};
+};
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <esp_timer.h>
+#include <utils/median_filter.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#ifndef SONAR_PING_INTERVAL_US
+// Minimum spacing between pings. Sensors fire alternately so one's echo can't be heard by the other; HC-SR04 modules
+// need ~29 ms for stray echoes to die out.
+#define SONAR_PING_INTERVAL_US 30000
+#endif
+
+#ifndef SONAR_MEDIAN_WINDOW
+#define SONAR_MEDIAN_WINDOW 5
+#endif
+
+struct sonar_reading_t {
+    float distance {0}; // cm, median of the last pings; max range when nothing echoed
+    int64_t time {0};   // esp_timer time (us) the newest ping was sent, 0 until the first reading
+};
+
+/*
+ * Non-blocking scheduler for a left/right pair of ultrasonic rangers. update() is called periodically: it completes
+ * the ping in flight, filters it, and fires the other sensor once the ping interval has passed. Nothing waits on an
+ * echo, so a call costs a few microseconds plus the trigger pulse.
+ *
+ * Driver provides begin(trigger_pin, echo_pin, max_cm), trigger(now) and poll(cm, now) returning Driver::Status.
+ */
+template <class Driver, size_t Window = SONAR_MEDIAN_WINDOW>
+class SonarPair {
+  public:
+    enum Side : uint8_t { LEFT = 0, RIGHT = 1 };
+
+    bool initialize(int left_trigger, int left_echo, int right_trigger, int right_echo, float max_cm) {
+        _max_cm = max_cm;
+        _readings[LEFT].distance = _readings[RIGHT].distance = max_cm;
+        _enabled[LEFT] = _drivers[LEFT].begin(left_trigger, left_echo, max_cm);
+        _enabled[RIGHT] = _drivers[RIGHT].begin(right_trigger, right_echo, max_cm);
+        _active = _enabled[LEFT] ? LEFT : RIGHT;
+        return _enabled[LEFT] || _enabled[RIGHT];
+    }
+
+    // Returns true when a new reading was filtered in.
+    bool update(int64_t now = esp_timer_get_time()) {
+        if (!_enabled[_active]) return false;
+        bool fresh = false;
+        if (_in_flight) {
+            float cm = _max_cm;
+            const auto status = _drivers[_active].poll(cm, now);
+            if (status == Driver::Status::PENDING) return false;
+            if (status != Driver::Status::DONE) cm = _max_cm;
+            _readings[_active].distance = _filters[_active].push(std::min(cm, _max_cm));
+            _readings[_active].time = _ping_time;
+            _in_flight = false;
+            fresh = true;
+            if (_enabled[_active ^ 1]) _active = static_cast<Side>(_active ^ 1);
+        }
+        if (now - _ping_time >= SONAR_PING_INTERVAL_US && _drivers[_active].trigger(now)) {
+            _ping_time = now;
+            _in_flight = true;
+        }
+        return fresh;
+    }
+
+    const sonar_reading_t &reading(Side side) const { return _readings[side]; }
+
+    bool isActive() const { return _enabled[LEFT] || _enabled[RIGHT]; }
+
+    Driver &driver(Side side) { return _drivers[side]; }
+
+  private:
+    Driver _drivers[2];
+    MedianFilter<float, Window> _filters[2];
+    sonar_reading_t _readings[2];
+    bool _enabled[2] {false, false};
+    Side _active {LEFT};
+    bool _in_flight {false};
+    int64_t _ping_time {-SONAR_PING_INTERVAL_US};
+    float _max_cm {0};
+};
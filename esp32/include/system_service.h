@@ -21,6 +21,11 @@ void reset();
 void restart();
 void sleep();
 void getAnalytics(socket_message_AnalyticsData &analytics);
+
+// Takes a scheduler snapshot for getTaskStats and the CPU load in getAnalytics. False when the build has no FreeRTOS
+// run-time stats (CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS) or runs more than TASK_STATS_MAX_TASKS tasks.
+bool sampleTasks();
+void getTaskStats(socket_message_TaskStatsData &data);
 void getStaticSystemInformation(socket_message_StaticSystemInformation &info);
 
 const char *resetReason(esp_reset_reason_t reason);
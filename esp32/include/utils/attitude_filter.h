@@ -0,0 +1,83 @@
+#pragma once
+
+#include <utils/fixed_point.h>
+
+#include <cmath>
+
+inline void normalize(float *v, int n) {
+    float sum = 0;
+    for (int i = 0; i < n; i++) sum += v[i] * v[i];
+    if (sum <= 0.0f) return;
+    const float recip = 1.0f / std::sqrt(sum);
+    for (int i = 0; i < n; i++) v[i] *= recip;
+}
+
+inline float toFloat(float x) { return x; }
+
+/*
+ * Madgwick gradient descent attitude filter, gyro + accelerometer (IMU) form, after S. Madgwick, "An efficient
+ * orientation filter for inertial and inertial/magnetic sensor arrays", 2010. Gyro rates integrate the quaternion and
+ * the normalised accelerometer pulls it towards gravity with gain beta; yaw is gyro-only and drifts.
+ *
+ * S is the arithmetic type: float on chips with an FPU, Fixed<24> for an integer-only path. The quaternion is
+ * (w, x, y, z) and has the same convention as the MPU6050 DMP output, so both feed the same Euler conversion.
+ */
+template <typename S>
+class Madgwick {
+  public:
+    using Scalar = S;
+
+    explicit Madgwick(float beta = 0.1f) : _beta(beta) {}
+
+    // gx..gz in rad/s, ax..az in any unit (only the direction is used), dt in seconds.
+    void update(S gx, S gy, S gz, S ax, S ay, S az, S dt) {
+        const S half(0.5f), two(2.0f), four(4.0f), eight(8.0f), zero(0.0f);
+        S &q0 = _q[0], &q1 = _q[1], &q2 = _q[2], &q3 = _q[3];
+
+        S qdot[4] = {half * (-q1 * gx - q2 * gy - q3 * gz), half * (q0 * gx + q2 * gz - q3 * gy),
+                     half * (q0 * gy - q1 * gz + q3 * gx), half * (q0 * gz + q1 * gy - q2 * gx)};
+
+        // A free-falling or unread accelerometer gives no reference, integrate the gyro alone.
+        if (!(ax == zero && ay == zero && az == zero)) {
+            S a[3] = {ax, ay, az};
+            normalize(a, 3);
+
+            const S _2q0 = two * q0, _2q1 = two * q1, _2q2 = two * q2, _2q3 = two * q3;
+            const S _4q0 = four * q0, _4q1 = four * q1, _4q2 = four * q2;
+            const S _8q1 = eight * q1, _8q2 = eight * q2;
+            const S q0q0 = q0 * q0, q1q1 = q1 * q1, q2q2 = q2 * q2, q3q3 = q3 * q3;
+
+            S s[4] = {
+                _4q0 * q2q2 + _2q2 * a[0] + _4q0 * q1q1 - _2q1 * a[1],
+                _4q1 * q3q3 - _2q3 * a[0] + four * q0q0 * q1 - _2q0 * a[1] - _4q1 + _8q1 * q1q1 + _8q1 * q2q2 +
+                    _4q1 * a[2],
+                four * q0q0 * q2 + _2q0 * a[0] + _4q2 * q3q3 - _2q3 * a[1] - _4q2 + _8q2 * q1q1 + _8q2 * q2q2 +
+                    _4q2 * a[2],
+                four * q1q1 * q3 - _2q1 * a[0] + four * q2q2 * q3 - _2q2 * a[1],
+            };
+            normalize(s, 4);
+            for (int i = 0; i < 4; i++) qdot[i] -= _beta * s[i];
+        }
+
+        for (int i = 0; i < 4; i++) _q[i] += qdot[i] * dt;
+        normalize(_q, 4);
+    }
+
+    void quaternion(float q[4]) const {
+        for (int i = 0; i < 4; i++) q[i] = toFloat(_q[i]);
+    }
+
+    void reset() {
+        _q[0] = S(1.0f);
+        _q[1] = _q[2] = _q[3] = S(0.0f);
+    }
+
+    void setBeta(float beta) { _beta = S(beta); }
+
+  private:
+    S _q[4] {S(1.0f), S(0.0f), S(0.0f), S(0.0f)};
+    S _beta;
+};
+
+using MadgwickFloat = Madgwick<float>;
+using MadgwickFixed = Madgwick<Fixed<24>>;
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+
+/*
+ * A 1-D Bezier curve over its control points, sampled at Resolution + 1 evenly spaced phases at compile time.
+ * Lookups interpolate linearly between samples, replacing the per-call Bernstein sum (a pow, N divisions and N
+ * multiply-adds per axis) with one table index and a multiply-add.
+ */
+template <size_t N, size_t Resolution>
+class BezierTable {
+    static_assert(N >= 2, "a Bezier curve needs at least two control points");
+    static_assert(Resolution >= 1, "the table needs at least two samples");
+
+  public:
+    static constexpr size_t resolution = Resolution;
+
+    float samples[Resolution + 1] {};
+
+    explicit constexpr BezierTable(const float (&control)[N]) {
+        constexpr size_t degree = N - 1;
+        for (size_t k = 0; k <= Resolution; k++) {
+            const double t = static_cast<double>(k) / Resolution;
+            double sum = 0;
+            for (size_t i = 0; i <= degree; i++) sum += bernstein(degree, i, t) * control[i];
+            samples[k] = static_cast<float>(sum);
+        }
+    }
+
+    // Curve value at phase t in [0, 1]; t outside the range is clamped.
+    inline float operator()(float t) const {
+        float x = t * Resolution;
+        if (!(x > 0.0f)) return samples[0];
+        if (x >= Resolution) return samples[Resolution];
+        const size_t i = static_cast<size_t>(x);
+        const float frac = x - i;
+        return samples[i] + (samples[i + 1] - samples[i]) * frac;
+    }
+
+    // Exact curve value for reference and tests.
+    static constexpr double evaluate(const float (&control)[N], double t) {
+        double sum = 0;
+        for (size_t i = 0; i < N; i++) sum += bernstein(N - 1, i, t) * control[i];
+        return sum;
+    }
+
+  private:
+    static constexpr double bernstein(size_t n, size_t i, double t) {
+        double coefficient = 1;
+        for (size_t j = 0; j < i; j++) coefficient = coefficient * (n - j) / (j + 1);
+        double value = coefficient;
+        for (size_t j = 0; j < i; j++) value *= t;
+        for (size_t j = i; j < n; j++) value *= 1 - t;
+        return value;
+    }
+};
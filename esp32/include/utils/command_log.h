@@ -0,0 +1,299 @@
+#pragma once
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <message_types.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+// Bytes of records buffered in RAM between flushes, per half of the double buffer. At 50 controller updates a
+// second that is over a second of input, against the service task flushing every 100 ms.
+#ifndef COMMAND_LOG_BUFFER_SIZE
+#define COMMAND_LOG_BUFFER_SIZE 2048
+#endif
+
+// Records that would grow the file past this size are dropped and counted.
+#ifndef COMMAND_LOG_MAX_BYTES
+#define COMMAND_LOG_MAX_BYTES (1024 * 1024)
+#endif
+
+/*
+ * Command log file format, little-endian (the ESP32 and the hosts that replay it):
+ *
+ *   header  "SPCL", uint16 version, uint16 reserved
+ *   record  uint8 type, uint32 microseconds since the previous record (or the start), payload
+ *
+ * The payload size is fixed per type. Controller input is stored as the seven CommandMsg floats, so a replay sees
+ * bit-identical values; other records are a byte or a few int16. A gap longer than ~71 minutes saturates the delta,
+ * which only shortens an idle stretch on replay.
+ */
+namespace command_log {
+
+static constexpr char MAGIC[4] = {'S', 'P', 'C', 'L'};
+static constexpr uint16_t VERSION = 1;
+static constexpr size_t HEADER_SIZE = 8;
+static constexpr size_t RECORD_HEADER_SIZE = 5;
+
+enum class Type : uint8_t {
+    CONTROLLER = 1, // CommandMsg
+    LINK_LOST = 2,  // no payload
+    MODE = 3,       // uint8 socket_message_ModesEnum
+    WALK_GAIT = 4,  // uint8 socket_message_WalkGaits
+    ANGLES = 5,     // uint8 count, 12 x int16 degrees
+    GESTURE = 6,    // uint16 gesture_t
+};
+
+inline size_t payloadSize(Type type) {
+    switch (type) {
+        case Type::CONTROLLER: return sizeof(CommandMsg);
+        case Type::LINK_LOST: return 0;
+        case Type::MODE:
+        case Type::WALK_GAIT: return 1;
+        case Type::ANGLES: return 1 + 12 * sizeof(int16_t);
+        case Type::GESTURE: return sizeof(uint16_t);
+    }
+    return SIZE_MAX;
+}
+
+struct record_t {
+    int64_t time_us {0}; // since the start of the recording
+    Type type {Type::CONTROLLER};
+    CommandMsg input {};
+    uint8_t mode {0};
+    uint8_t gait {0};
+    uint8_t angle_count {0};
+    int32_t angles[12] {};
+    uint16_t gesture {0};
+};
+
+/*
+ * Records what reaches MotionService's handlers, stamped with esp_timer time. Producers (the websocket task, and
+ * the control task for gestures) only append to a RAM buffer under a short lock and never touch the filesystem; the
+ * service task calls flush() to swap the buffers and write the full one out. A full buffer drops the record and
+ * counts it rather than block a producer on flash.
+ */
+class Recorder {
+  public:
+    Recorder() : _lock(xSemaphoreCreateMutex()), _file_lock(xSemaphoreCreateMutex()) {}
+    ~Recorder() {
+        stop();
+        vSemaphoreDelete(_lock);
+        vSemaphoreDelete(_file_lock);
+    }
+
+    bool start(const char *path) {
+        Lock file_lock(_file_lock);
+        closeFile();
+        FILE *file = fopen(path, "wb");
+        if (!file) {
+            ESP_LOGE(TAG, "Failed to open %s", path);
+            return false;
+        }
+        uint8_t header[HEADER_SIZE] = {};
+        std::memcpy(header, MAGIC, sizeof(MAGIC));
+        std::memcpy(header + sizeof(MAGIC), &VERSION, sizeof(VERSION));
+        fwrite(header, 1, sizeof(header), file);
+
+        Lock lock(_lock);
+        _file = file;
+        _bytes = sizeof(header);
+        _dropped = 0;
+        _fill = 0;
+        _last_us = esp_timer_get_time();
+        _last_input_valid = false;
+        _recording = true;
+        ESP_LOGI(TAG, "Recording commands to %s", path);
+        return true;
+    }
+
+    // Writes what is buffered and closes the file.
+    void stop() {
+        Lock file_lock(_file_lock);
+        closeFile();
+    }
+
+    // Service task: writes out the records buffered since the last flush.
+    void flush() {
+        Lock file_lock(_file_lock);
+        writeBuffered();
+    }
+
+    bool recording() const { return _recording; }
+    uint32_t bytes() const { return _bytes; }
+    uint32_t dropped() const { return _dropped; }
+
+    // Controller input and link loss come from one task (the websocket's). An input identical to the previous one
+    // changes nothing downstream, so it is not recorded again.
+    void recordInput(const CommandMsg &input) {
+        if (_last_input_valid && std::memcmp(&input, &_last_input, sizeof(input)) == 0) return;
+        if (append(Type::CONTROLLER, &input)) {
+            _last_input = input;
+            _last_input_valid = true;
+        }
+    }
+
+    void recordLinkLost() {
+        if (append(Type::LINK_LOST, nullptr)) _last_input_valid = false;
+    }
+
+    void recordMode(uint8_t mode) { append(Type::MODE, &mode); }
+
+    void recordWalkGait(uint8_t gait) { append(Type::WALK_GAIT, &gait); }
+
+    void recordAngles(const int32_t *angles, size_t count) {
+        uint8_t payload[1 + 12 * sizeof(int16_t)] = {};
+        payload[0] = static_cast<uint8_t>(std::min<size_t>(count, 12));
+        for (int i = 0; i < payload[0]; i++) {
+            const int16_t angle = static_cast<int16_t>(std::clamp<int32_t>(angles[i], INT16_MIN, INT16_MAX));
+            std::memcpy(payload + 1 + i * sizeof(int16_t), &angle, sizeof(angle));
+        }
+        append(Type::ANGLES, payload);
+    }
+
+    void recordGesture(uint16_t gesture) { append(Type::GESTURE, &gesture); }
+
+  private:
+    static constexpr const char *TAG = "CommandLog";
+
+    struct Lock {
+        SemaphoreHandle_t sem;
+        explicit Lock(SemaphoreHandle_t sem) : sem(sem) { xSemaphoreTake(sem, portMAX_DELAY); }
+        ~Lock() { xSemaphoreGive(sem); }
+    };
+
+    // The file functions run with _file_lock held, so only one of them touches the FILE at a time.
+    void writeBuffered() {
+        size_t size;
+        const uint8_t *data;
+        {
+            Lock lock(_lock);
+            if (!_file || !_fill) return;
+            data = _buffers[_active];
+            size = _fill;
+            _active ^= 1;
+            _fill = 0;
+        }
+        fwrite(data, 1, size, _file);
+        fflush(_file);
+    }
+
+    void closeFile() {
+        {
+            Lock lock(_lock);
+            if (!_recording) return;
+            _recording = false;
+        }
+        writeBuffered();
+        fclose(_file);
+        _file = nullptr;
+        ESP_LOGI(TAG, "Recorded %u bytes, %u records dropped", static_cast<unsigned>(_bytes),
+                 static_cast<unsigned>(_dropped));
+    }
+
+    bool append(Type type, const void *payload) {
+        if (!_recording) return false;
+        const int64_t now = esp_timer_get_time();
+        const size_t size = RECORD_HEADER_SIZE + payloadSize(type);
+        Lock lock(_lock);
+        if (!_recording) return false;
+        if (_fill + size > COMMAND_LOG_BUFFER_SIZE || _bytes + size > COMMAND_LOG_MAX_BYTES) {
+            _dropped++;
+            return false;
+        }
+        // Producers stamp before taking the lock, so two of them can arrive out of order by a few microseconds.
+        const uint32_t delta = static_cast<uint32_t>(std::clamp<int64_t>(now - _last_us, 0, UINT32_MAX));
+        _last_us = std::max(_last_us, now);
+        uint8_t *out = _buffers[_active] + _fill;
+        out[0] = static_cast<uint8_t>(type);
+        std::memcpy(out + 1, &delta, sizeof(delta));
+        if (payload) std::memcpy(out + RECORD_HEADER_SIZE, payload, payloadSize(type));
+        _fill += size;
+        _bytes += size;
+        return true;
+    }
+
+    SemaphoreHandle_t _lock;      // buffers and counters, held only to copy a record in
+    SemaphoreHandle_t _file_lock; // the FILE, held across flash writes
+    FILE *_file {nullptr};
+    volatile bool _recording {false};
+    uint8_t _buffers[2][COMMAND_LOG_BUFFER_SIZE];
+    int _active {0};
+    size_t _fill {0};
+    uint32_t _bytes {0};
+    uint32_t _dropped {0};
+    int64_t _last_us {0};
+    CommandMsg _last_input {};
+    bool _last_input_valid {false};
+};
+
+// Reads a command log back, one record at a time.
+class Reader {
+  public:
+    ~Reader() { close(); }
+
+    bool open(const char *path) {
+        close();
+        _file = fopen(path, "rb");
+        if (!_file) return false;
+        uint8_t header[HEADER_SIZE];
+        uint16_t version = 0;
+        if (fread(header, 1, sizeof(header), _file) != sizeof(header) ||
+            std::memcmp(header, MAGIC, sizeof(MAGIC)) != 0 ||
+            (std::memcpy(&version, header + sizeof(MAGIC), sizeof(version)), version != VERSION)) {
+            close();
+            return false;
+        }
+        _time_us = 0;
+        return true;
+    }
+
+    void close() {
+        if (_file) fclose(_file);
+        _file = nullptr;
+    }
+
+    // False at the end of the log, or at a truncated or unknown record.
+    bool next(record_t &record) {
+        if (!_file) return false;
+        uint8_t header[RECORD_HEADER_SIZE];
+        if (fread(header, 1, sizeof(header), _file) != sizeof(header)) return false;
+        const Type type = static_cast<Type>(header[0]);
+        const size_t size = payloadSize(type);
+        uint8_t payload[64];
+        if (size > sizeof(payload) || fread(payload, 1, size, _file) != size) return false;
+        uint32_t delta;
+        std::memcpy(&delta, header + 1, sizeof(delta));
+        _time_us += delta;
+
+        record = record_t();
+        record.time_us = _time_us;
+        record.type = type;
+        switch (type) {
+            case Type::CONTROLLER: std::memcpy(&record.input, payload, sizeof(record.input)); break;
+            case Type::LINK_LOST: break;
+            case Type::MODE: record.mode = payload[0]; break;
+            case Type::WALK_GAIT: record.gait = payload[0]; break;
+            case Type::ANGLES:
+                record.angle_count = std::min<uint8_t>(payload[0], 12);
+                for (int i = 0; i < record.angle_count; i++) {
+                    int16_t angle;
+                    std::memcpy(&angle, payload + 1 + i * sizeof(int16_t), sizeof(angle));
+                    record.angles[i] = angle;
+                }
+                break;
+            case Type::GESTURE: std::memcpy(&record.gesture, payload, sizeof(record.gesture)); break;
+        }
+        return true;
+    }
+
+  private:
+    FILE *_file {nullptr};
+    int64_t _time_us {0};
+};
+
+} // namespace command_log
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cmath>
+
+/*
+ * Branch-free polynomial approximations for the kinematics hot path. Every function is a handful of multiply-adds
+ * plus selects, so they inline and auto-vectorize; none of them handle NaN/Inf.
+ *
+ * Maximum absolute error, measured over the full input range on the host:
+ *   fast_atan2f              1.2e-5 rad (0.0007 deg)
+ *   fast_acosf               6.8e-5 rad (0.0039 deg)
+ *   fast_sinf, fast_cosf     3.6e-6 for |x| <= 8 pi
+ */
+
+namespace fast_math {
+
+static constexpr float PI_F = 3.14159265f;
+static constexpr float PI_2_F = 1.57079633f;
+
+// atan on [-1, 1], Abramowitz & Stegun 4.4.49
+inline float atan_unit(float x) {
+    const float x2 = x * x;
+    return x * (0.9998660f + x2 * (-0.3302995f + x2 * (0.1801410f + x2 * (-0.0851330f + x2 * 0.0208351f))));
+}
+
+inline float fast_atan2f(float y, float x) {
+    const float ax = std::fabs(x), ay = std::fabs(y);
+    const float mx = ax > ay ? ax : ay;
+    const float mn = ax > ay ? ay : ax;
+    float r = atan_unit(mn / (mx > 0.0f ? mx : 1.0f));
+    r = ay > ax ? PI_2_F - r : r;
+    r = x < 0.0f ? PI_F - r : r;
+    return y < 0.0f ? -r : r;
+}
+
+// Abramowitz & Stegun 4.4.45
+inline float fast_acosf(float x) {
+    const float ax = std::fabs(x);
+    const float poly = 1.5707288f + ax * (-0.2121144f + ax * (0.0742610f - 0.0187293f * ax));
+    const float r = std::sqrt(1.0f - (ax < 1.0f ? ax : 1.0f)) * poly;
+    return x < 0.0f ? PI_F - r : r;
+}
+
+// sin with reduction to [-pi/2, pi/2] around the nearest multiple of pi
+inline float fast_sinf(float x) {
+    const float k = std::nearbyint(x * (1.0f / PI_F));
+    const float r = (x - k * 3.14159274f) + k * 8.74227766e-8f;
+    const float r2 = r * r;
+    const float s =
+        r * (1.0f + r2 * (-0.16666667f + r2 * (0.0083333310f + r2 * (-0.00019840874f + r2 * 2.7525562e-6f))));
+    const int odd = static_cast<int>(k) & 1;
+    return odd ? -s : s;
+}
+
+inline float fast_cosf(float x) { return fast_sinf(x + PI_2_F); }
+
+} // namespace fast_math
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+ * Signed fixed point number with FracBits fractional bits in an int32_t. Products and quotients go through int64_t,
+ * so no operation needs the FPU; float conversions are constexpr and fold away for constants. Overflow is not
+ * checked, callers keep values within +-2^(31 - FracBits).
+ */
+template <int FracBits>
+struct Fixed {
+    static_assert(FracBits > 0 && FracBits < 31, "fraction must leave room for sign and integer bits");
+
+    static constexpr int32_t ONE = int32_t(1) << FracBits;
+
+    int32_t raw {0};
+
+    constexpr Fixed() = default;
+    constexpr Fixed(float value) : raw(static_cast<int32_t>(value * ONE + (value < 0 ? -0.5f : 0.5f))) {}
+
+    static constexpr Fixed fromRaw(int32_t raw) {
+        Fixed f;
+        f.raw = raw;
+        return f;
+    }
+
+    constexpr float toFloat() const { return raw * (1.0f / ONE); }
+    constexpr explicit operator float() const { return toFloat(); }
+
+    constexpr Fixed operator-() const { return fromRaw(-raw); }
+    constexpr Fixed operator+(Fixed o) const { return fromRaw(raw + o.raw); }
+    constexpr Fixed operator-(Fixed o) const { return fromRaw(raw - o.raw); }
+    constexpr Fixed operator*(Fixed o) const {
+        return fromRaw(static_cast<int32_t>((static_cast<int64_t>(raw) * o.raw) >> FracBits));
+    }
+    constexpr Fixed operator/(Fixed o) const {
+        return fromRaw(static_cast<int32_t>((static_cast<int64_t>(raw) << FracBits) / o.raw));
+    }
+    // Scaling by an integer, e.g. a raw sensor count, is a plain multiply.
+    constexpr Fixed operator*(int32_t n) const { return fromRaw(raw * n); }
+
+    Fixed &operator+=(Fixed o) { return *this = *this + o; }
+    Fixed &operator-=(Fixed o) { return *this = *this - o; }
+    Fixed &operator*=(Fixed o) { return *this = *this * o; }
+
+    constexpr bool operator==(Fixed o) const { return raw == o.raw; }
+    constexpr bool operator!=(Fixed o) const { return raw != o.raw; }
+};
+
+namespace fixed_detail {
+
+// floor(sqrt(x)), bit by bit.
+constexpr uint64_t isqrt(uint64_t x) {
+    uint64_t result = 0;
+    uint64_t bit = uint64_t(1) << 62;
+    while (bit > x) bit >>= 2;
+    while (bit) {
+        if (x >= result + bit) {
+            x -= result + bit;
+            result = (result >> 1) + bit;
+        } else {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+    return result;
+}
+
+} // namespace fixed_detail
+
+/*
+ * Scales v to unit length, leaving an all-zero vector alone. Squares are summed at double precision (Q2F in an
+ * int64_t), so short vectors such as a converged filter gradient keep their direction instead of rounding to zero.
+ */
+template <int F>
+void normalize(Fixed<F> *v, int n) {
+    uint64_t sum = 0;
+    for (int i = 0; i < n; i++) sum += static_cast<uint64_t>(static_cast<int64_t>(v[i].raw) * v[i].raw);
+    const int64_t norm = static_cast<int64_t>(fixed_detail::isqrt(sum));
+    if (!norm) return;
+    for (int i = 0; i < n; i++) v[i].raw = static_cast<int32_t>((static_cast<int64_t>(v[i].raw) << F) / norm);
+}
+
+template <int F>
+constexpr float toFloat(Fixed<F> x) {
+    return x.toFloat();
+}
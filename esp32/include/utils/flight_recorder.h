@@ -0,0 +1,218 @@
+#pragma once
+
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+#include <utils/math_utils.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+// Ring size in records (136 bytes each) when the board has PSRAM: ~20 s at 100 Hz.
+#ifndef FLIGHT_RECORDER_RECORDS
+#define FLIGHT_RECORDER_RECORDS 2048
+#endif
+
+// Ring size in internal RAM on boards without PSRAM.
+#ifndef FLIGHT_RECORDER_RECORDS_INTERNAL
+#define FLIGHT_RECORDER_RECORDS_INTERNAL 256
+#endif
+
+// Ticks still recorded after an automatic trigger, so the capture shows the aftermath as well as the lead-up.
+#ifndef FLIGHT_RECORDER_POST_TRIGGER
+#define FLIGHT_RECORDER_POST_TRIGGER 100
+#endif
+
+// Roll or pitch beyond this freezes the recorder.
+#ifndef FLIGHT_RECORDER_TILT_DEG
+#define FLIGHT_RECORDER_TILT_DEG 45
+#endif
+
+// A wake that comes this many periods late freezes the recorder.
+#ifndef FLIGHT_RECORDER_MISSED_TICKS
+#define FLIGHT_RECORDER_MISSED_TICKS 3
+#endif
+
+/*
+ * Always-on flight recorder for the control loop: one fixed-size record per tick in a ring, frozen when something goes
+ * wrong so the seconds before it can be pulled off the robot. A dump is a file header followed by the records oldest
+ * first, little-endian, read by the host decoder (esp32/test/host/flight_decode).
+ */
+namespace flight_recorder {
+
+enum Trigger : uint8_t { NONE = 0, MANUAL = 1, TILT = 2, DEADLINE = 3 };
+
+static constexpr char MAGIC[4] = {'S', 'P', 'F', 'R'};
+static constexpr uint16_t VERSION = 1;
+
+// Ordered so every field is naturally aligned: no padding, and no unaligned float access on the Xtensa cores.
+struct record_t {
+    uint32_t time_us;   // esp_timer time of the wake, low 32 bits
+    float body[6];      // omega, phi, psi, xm, ym, zm
+    float feet[4][3];   // x, y, z per leg
+    uint16_t dt_us;     // since the previous wake, saturated
+    uint16_t busy_us;   // wake to the end of the tick, saturated
+    int16_t target[12]; // joint targets, centidegrees
+    int16_t angles[12]; // trajectory-limited joint angles sent to the servos, centidegrees
+    int16_t imu[3];     // x, y, z, centidegrees
+    uint8_t mode;       // MOTION_STATE
+    uint8_t missed;     // periods that elapsed before this wake without one, saturated
+};
+static_assert(sizeof(record_t) == 136, "record layout is part of the dump format");
+
+struct file_header_t {
+    char magic[4];
+    uint16_t version;
+    uint16_t record_size;
+    uint32_t count;
+    uint32_t trigger_index; // record that tripped the trigger, counted from the first in the file
+    uint8_t trigger;
+    uint8_t reserved[3];
+};
+static_assert(sizeof(file_header_t) == 20, "header layout is part of the dump format");
+
+inline int16_t centidegrees(float degrees) {
+    return static_cast<int16_t>(std::clamp(std::lround(degrees * 100), -32768L, 32767L));
+}
+
+// IMU angles come from the drivers in radians.
+inline int16_t imuCentidegrees(float radians) { return centidegrees(RAD_TO_DEG_F(radians)); }
+
+inline uint16_t saturate16(int64_t value) { return static_cast<uint16_t>(std::clamp<int64_t>(value, 0, UINT16_MAX)); }
+
+/*
+ * The control task calls record() every tick and is the only writer of the ring. A trigger (tilt, a late wake, or
+ * freeze() from any task) lets it record the post-trigger ticks and then stop; the service task sees frozen(),
+ * writes the ring out with dump() and re-arms it. While frozen nothing is written, so dump() reads a stable ring
+ * without a lock. Tilt triggers on the edge, a robot lying on its side freezes once rather than after every dump.
+ */
+class Recorder {
+  public:
+    ~Recorder() { heap_caps_free(_records); }
+
+    // Allocates the ring, in PSRAM when the board has it. capacity 0 picks the configured size for the memory.
+    bool begin(size_t capacity = 0) {
+        const bool psram = heap_caps_get_total_size(MALLOC_CAP_SPIRAM) > 0;
+        if (!capacity) capacity = psram ? FLIGHT_RECORDER_RECORDS : FLIGHT_RECORDER_RECORDS_INTERNAL;
+        const uint32_t caps = psram ? MALLOC_CAP_SPIRAM : MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+        _records = static_cast<record_t *>(heap_caps_malloc(capacity * sizeof(record_t), caps));
+        if (!_records) {
+            ESP_LOGE(TAG, "No memory for %u records", static_cast<unsigned>(capacity));
+            return false;
+        }
+        _capacity = capacity;
+        _post_trigger = std::min<size_t>(FLIGHT_RECORDER_POST_TRIGGER, capacity / 2);
+        ESP_LOGI(TAG, "%u records in %s", static_cast<unsigned>(capacity), psram ? "PSRAM" : "internal RAM");
+        return true;
+    }
+
+    // Control task, once per tick.
+    void record(const record_t &record) {
+        if (!_records || _frozen.load(std::memory_order_acquire)) return;
+        _records[_head] = record;
+        _head = (_head + 1) % _capacity;
+        _count = std::min(_count + 1, _capacity);
+        _written++;
+
+        // Checked every tick, so the tilt edge follows the robot while frozen for the post-trigger ticks too.
+        const Trigger trigger = check(record);
+        if (_trigger == NONE) {
+            if (trigger == NONE) return;
+            _trigger = trigger;
+            _trigger_seq = _written - 1;
+            _post_remaining = trigger == MANUAL ? 0 : _post_trigger;
+            ESP_LOGW(TAG, "Triggered (%s)", triggerName(trigger));
+        }
+        if (_post_remaining-- == 0) _frozen.store(true, std::memory_order_release);
+    }
+
+    // Any task: freezes at the next tick.
+    void freeze() { _freeze_requested.store(true, std::memory_order_relaxed); }
+
+    bool frozen() const { return _frozen.load(std::memory_order_acquire); }
+
+    /*
+     * Service task: writes a frozen ring to path oldest first and re-arms the recorder. Returns false if nothing was
+     * frozen or the file could not be written; the recorder re-arms either way so it stays always-on.
+     */
+    bool dump(const char *path) {
+        if (!frozen()) return false;
+        FILE *file = fopen(path, "wb");
+        bool ok = file != nullptr;
+        if (ok) {
+            const size_t oldest = (_head + _capacity - _count) % _capacity;
+            file_header_t header = {};
+            std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+            header.version = VERSION;
+            header.record_size = sizeof(record_t);
+            header.count = static_cast<uint32_t>(_count);
+            header.trigger_index = static_cast<uint32_t>(_trigger_seq - (_written - _count));
+            header.trigger = _trigger;
+            const size_t first = std::min(_count, _capacity - oldest);
+            ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                 fwrite(_records + oldest, sizeof(record_t), first, file) == first &&
+                 fwrite(_records, sizeof(record_t), _count - first, file) == _count - first;
+            ok = fclose(file) == 0 && ok;
+        }
+        if (ok) {
+            ESP_LOGI(TAG, "Wrote %u records to %s", static_cast<unsigned>(_count), path);
+        } else {
+            ESP_LOGE(TAG, "Failed to write %s", path);
+        }
+        _count = 0;
+        _trigger = NONE;
+        _freeze_requested.store(false, std::memory_order_relaxed);
+        _frozen.store(false, std::memory_order_release);
+        return ok;
+    }
+
+    size_t capacity() const { return _capacity; }
+
+    // While frozen: what tripped the recorder and how many records a dump holds.
+    Trigger trigger() const { return _trigger; }
+    size_t records() const { return _count; }
+
+    static const char *triggerName(Trigger trigger) {
+        switch (trigger) {
+            case MANUAL: return "manual";
+            case TILT: return "tilt";
+            case DEADLINE: return "deadline";
+            default: return "none";
+        }
+    }
+
+  private:
+    static constexpr const char *TAG = "FlightRecorder";
+
+    Trigger check(const record_t &record) {
+        const int16_t limit = FLIGHT_RECORDER_TILT_DEG * 100;
+        const bool tilted = std::abs(record.imu[0]) > limit || std::abs(record.imu[1]) > limit;
+        const bool rising = tilted && !_tilted;
+        _tilted = tilted;
+        if (_freeze_requested.exchange(false, std::memory_order_relaxed)) return MANUAL;
+        if (rising) return TILT;
+        if (record.missed >= FLIGHT_RECORDER_MISSED_TICKS) return DEADLINE;
+        return NONE;
+    }
+
+    record_t *_records {nullptr};
+    size_t _capacity {0};
+    size_t _post_trigger {0};
+
+    // Control task only, or the service task while frozen.
+    size_t _head {0};
+    size_t _count {0};
+    uint64_t _written {0};
+    uint64_t _trigger_seq {0};
+    size_t _post_remaining {0};
+    Trigger _trigger {NONE};
+    bool _tilted {false};
+
+    std::atomic<bool> _frozen {false};
+    std::atomic<bool> _freeze_requested {false};
+};
+
+} // namespace flight_recorder
@@ -0,0 +1,179 @@
+#pragma once
+
+#include "esp_timer.h"
+
+#include <utils/mailbox.h>
+#include <utils/trace.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+struct timing_summary_t {
+    uint32_t min_us {0};
+    uint32_t avg_us {0};
+    uint32_t p99_us {0};
+    uint32_t max_us {0};
+};
+
+/*
+ * Log-linear latency histogram: exact below 16 us, then 8 buckets per power of two (<= 12.5% bucket width) up to
+ * ~1 s. Fixed size and allocation free, so recording is a handful of integer ops.
+ */
+class LatencyHistogram {
+  public:
+    static constexpr size_t BUCKETS = 16 + 16 * 8;
+
+    void record(uint32_t us) {
+        counts[bucketOf(us)]++;
+        count++;
+        sum += us;
+        min = std::min(min, us);
+        max = std::max(max, us);
+    }
+
+    void reset() { *this = LatencyHistogram(); }
+
+    uint32_t samples() const { return count; }
+
+    // p99 is the upper edge of the bucket holding the 99th percentile sample, capped at the observed max.
+    timing_summary_t summary() const {
+        timing_summary_t out;
+        if (!count) return out;
+        out.min_us = min;
+        out.max_us = max;
+        out.avg_us = static_cast<uint32_t>(sum / count);
+        const uint32_t rank = count - count / 100;
+        uint32_t seen = 0;
+        for (size_t i = 0; i < BUCKETS; i++) {
+            seen += counts[i];
+            if (seen >= rank) {
+                out.p99_us = std::min(upperEdge(i), max);
+                break;
+            }
+        }
+        return out;
+    }
+
+    static size_t bucketOf(uint32_t us) {
+        if (us < 16) return us;
+        const int exponent = 31 - __builtin_clz(us);
+        const size_t bucket = 16 + (exponent - 4) * 8 + ((us >> (exponent - 3)) & 7);
+        return std::min(bucket, BUCKETS - 1);
+    }
+
+    static uint32_t upperEdge(size_t bucket) {
+        if (bucket < 16) return bucket;
+        const int exponent = 4 + (bucket - 16) / 8;
+        const uint32_t sub = (bucket - 16) % 8;
+        return (1u << exponent) + ((sub + 1) << (exponent - 3)) - 1;
+    }
+
+  private:
+    uint16_t counts[BUCKETS] {};
+    uint32_t count {0};
+    uint64_t sum {0};
+    uint32_t min {UINT32_MAX};
+    uint32_t max {0};
+};
+
+/*
+ * Per-stage timing of a fixed-rate loop. The loop task calls beginTick() when it wakes, mark() after each stage and
+ * endTick() before sleeping; every `window_ticks` ticks the histograms are summarised into a report and handed to
+ * the reader through a Mailbox, so the loop never blocks and never allocates.
+ *
+ * Jitter is the deviation of the wake-to-wake interval from the nominal period; overruns count ticks whose busy time
+ * exceeded the period.
+ *
+ * With USE_TRACE every stage is also a trace span named after it, so stages must be marked in order.
+ */
+template <size_t Stages>
+class LoopProfiler {
+  public:
+    struct Report {
+        uint32_t period_us {0};
+        uint32_t ticks {0};
+        uint32_t overruns {0};
+        timing_summary_t stages[Stages];
+        timing_summary_t busy;
+        timing_summary_t jitter;
+    };
+
+    LoopProfiler(const char *const (&names)[Stages], uint32_t period_us, uint32_t window_ticks)
+        : period_us(period_us), window_ticks(window_ticks) {
+        std::copy(names, names + Stages, stage_names);
+    }
+
+    const char *stageName(size_t stage) const { return stage_names[stage]; }
+
+    // Switches to a new nominal period, dropping the partial window that was measured against the old one.
+    void setPeriod(uint32_t period_us, uint32_t window_ticks) {
+        this->period_us = period_us;
+        this->window_ticks = window_ticks;
+        for (auto &stage : stages) stage.reset();
+        busy.reset();
+        jitter.reset();
+        overruns = 0;
+        last_wake = 0;
+    }
+
+    void beginTick(int64_t now = esp_timer_get_time()) {
+        if (last_wake) {
+            const int64_t interval = now - last_wake;
+            jitter.record(static_cast<uint32_t>(interval > period_us ? interval - period_us : period_us - interval));
+        }
+        last_wake = now;
+        tick_start = stage_start = now;
+        TRACE_BEGIN(stage_names[0]);
+    }
+
+    void mark(size_t stage, int64_t now = esp_timer_get_time()) {
+        stages[stage].record(static_cast<uint32_t>(now - stage_start));
+        stage_start = now;
+        TRACE_END(stage_names[stage]);
+        if (stage + 1 < Stages) TRACE_BEGIN(stage_names[stage + 1]);
+    }
+
+    void endTick(int64_t now = esp_timer_get_time()) {
+        const uint32_t elapsed = static_cast<uint32_t>(now - tick_start);
+        busy.record(elapsed);
+        if (elapsed > period_us) overruns++;
+        if (busy.samples() >= window_ticks) publish();
+    }
+
+    // Reader side: the newest completed window, or nullptr if none finished since the last call.
+    const typename Mailbox<Report>::Message *takeReport() { return reports.take(); }
+
+  private:
+    void publish() {
+        Report report;
+        report.period_us = period_us;
+        report.ticks = busy.samples();
+        report.overruns = overruns;
+        for (size_t i = 0; i < Stages; i++) {
+            report.stages[i] = stages[i].summary();
+            stages[i].reset();
+        }
+        report.busy = busy.summary();
+        report.jitter = jitter.summary();
+        busy.reset();
+        jitter.reset();
+        overruns = 0;
+        reports.post(report);
+    }
+
+    const char *stage_names[Stages];
+    uint32_t period_us;
+    uint32_t window_ticks;
+
+    LatencyHistogram stages[Stages];
+    LatencyHistogram busy;
+    LatencyHistogram jitter;
+    uint32_t overruns {0};
+    int64_t last_wake {0};
+    int64_t tick_start {0};
+    int64_t stage_start {0};
+
+    Mailbox<Report> reports;
+};
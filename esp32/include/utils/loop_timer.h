@@ -0,0 +1,126 @@
+#pragma once
+
+#include <esp_attr.h>
+#include <esp_err.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <algorithm>
+#include <cstdint>
+
+// Default control loop rate, changeable at runtime within LoopTimer::MIN_RATE_HZ..MAX_RATE_HZ.
+#ifndef CONTROL_LOOP_HZ
+#define CONTROL_LOOP_HZ 100
+#endif
+
+/*
+ * Fixed-rate wake-up for a loop task, driven by a periodic esp_timer instead of vTaskDelayUntil. The timer callback
+ * gives a task notification (from the ISR where esp_timer supports ISR dispatch), so the period is not quantised to
+ * the FreeRTOS tick and can be changed while running. wait() reports the measured interval since the previous wake,
+ * which is the dt to integrate, and counts timer periods that fired while the loop was still busy.
+ *
+ * On the host the esp_timer shim fires the callback as the clock reaches each deadline, so the same loop runs at
+ * its configured rate under the manual clock.
+ */
+class LoopTimer {
+  public:
+    static constexpr uint32_t MIN_RATE_HZ = 50;
+    static constexpr uint32_t MAX_RATE_HZ = 500;
+
+    LoopTimer() = default;
+    LoopTimer(const LoopTimer &) = delete;
+    LoopTimer &operator=(const LoopTimer &) = delete;
+    ~LoopTimer() { stop(); }
+
+    static uint32_t periodForRate(uint32_t rate_hz) {
+        return 1000000 / std::clamp(rate_hz, MIN_RATE_HZ, MAX_RATE_HZ);
+    }
+
+    // Starts waking the calling task at rate_hz (clamped to the supported range).
+    esp_err_t start(uint32_t rate_hz) {
+        if (_timer) return ESP_ERR_INVALID_STATE;
+        _task = xTaskGetCurrentTaskHandle();
+        esp_timer_create_args_t args = {};
+        args.callback = &LoopTimer::onTimer;
+        args.arg = this;
+        args.dispatch_method = DISPATCH;
+        args.name = "loop";
+        esp_err_t err = esp_timer_create(&args, &_timer);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to create loop timer: %s", esp_err_to_name(err));
+            _timer = nullptr;
+            return err;
+        }
+        _period_us = periodForRate(rate_hz);
+        _last_wake = esp_timer_get_time();
+        err = esp_timer_start_periodic(_timer, _period_us);
+        if (err != ESP_OK) ESP_LOGE(TAG, "Failed to start loop timer: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    // Changes the rate of a running timer; the next wake is one new period from now.
+    esp_err_t setRate(uint32_t rate_hz) {
+        if (!_timer) return ESP_ERR_INVALID_STATE;
+        const uint32_t period_us = periodForRate(rate_hz);
+        if (period_us == _period_us) return ESP_OK;
+        const esp_err_t err = esp_timer_restart(_timer, period_us);
+        if (err != ESP_OK) return err;
+        ESP_LOGI(TAG, "Loop rate %u Hz", static_cast<unsigned>(1000000 / period_us));
+        _period_us = period_us;
+        return ESP_OK;
+    }
+
+    void stop() {
+        if (!_timer) return;
+        esp_timer_stop(_timer);
+        esp_timer_delete(_timer);
+        _timer = nullptr;
+    }
+
+    /*
+     * Blocks until the next period and returns the seconds since the previous wake. Notifications that piled up while
+     * the loop overran are taken at once and counted as missed, so a late loop resumes on the timer's phase instead
+     * of running its backlog back to back. Waits at most a few periods, should the timer stop firing.
+     */
+    float wait() {
+        const TickType_t timeout = pdMS_TO_TICKS(4 * _period_us / 1000) + 1;
+        const uint32_t wakes = ulTaskNotifyTake(pdTRUE, timeout);
+        const int64_t now = esp_timer_get_time();
+        if (wakes > 1) _missed += wakes - 1;
+        const float dt = (now - _last_wake) * 1e-6f;
+        _last_wake = now;
+        return dt;
+    }
+
+    int64_t lastWake() const { return _last_wake; }
+    uint32_t periodUs() const { return _period_us; }
+    uint32_t rateHz() const { return 1000000 / _period_us; }
+
+    // Periods that elapsed without the loop waiting for them, since start.
+    uint32_t missed() const { return _missed; }
+
+  private:
+    static constexpr const char *TAG = "LoopTimer";
+
+#if CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD
+    static constexpr esp_timer_dispatch_t DISPATCH = ESP_TIMER_ISR;
+
+    static void IRAM_ATTR onTimer(void *arg) {
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(static_cast<LoopTimer *>(arg)->_task, &woken);
+        if (woken) esp_timer_isr_dispatch_need_yield();
+    }
+#else
+    static constexpr esp_timer_dispatch_t DISPATCH = ESP_TIMER_TASK;
+
+    static void onTimer(void *arg) { xTaskNotifyGive(static_cast<LoopTimer *>(arg)->_task); }
+#endif
+
+    esp_timer_handle_t _timer {nullptr};
+    TaskHandle_t _task {nullptr};
+    uint32_t _period_us {1000000 / CONTROL_LOOP_HZ};
+    int64_t _last_wake {0};
+    uint32_t _missed {0};
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "esp_timer.h"
+
+#include <atomic>
+#include <cstdint>
+
+/*
+ * Single-producer/single-consumer mailbox holding the latest posted value (triple buffer). The producer writes into
+ * a private slot and publishes it with one atomic exchange; the consumer swaps the published slot for its own. Both
+ * sides are wait-free, a value is never read while it is being written, and an unread value is simply replaced by a
+ * newer one.
+ *
+ * Exactly one task may call post() and exactly one task may call take().
+ */
+template <typename T>
+class Mailbox {
+  public:
+    struct Message {
+        T value {};
+        int64_t timestamp {0}; // esp_timer time of post(), microseconds
+        uint32_t sequence {0}; // 1 for the first post, counts every post including overwritten ones
+    };
+
+    // Producer side.
+    void post(const T &value, int64_t timestamp = esp_timer_get_time()) {
+        Message &slot = buffers[back];
+        slot.value = value;
+        slot.timestamp = timestamp;
+        slot.sequence = ++posted;
+        back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+    }
+
+    /*
+     * Consumer side. Returns the newest message if one was posted since the last take, nullptr otherwise. The
+     * message stays valid until the next call to take().
+     */
+    const Message *take() {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH)) return nullptr;
+        front = middle.exchange(front, std::memory_order_acq_rel) & INDEX_MASK;
+        return &buffers[front];
+    }
+
+  private:
+    static constexpr uint8_t INDEX_MASK = 0x3;
+    static constexpr uint8_t FRESH = 0x4;
+
+    Message buffers[3];
+    uint8_t back = 0;  // producer owned
+    uint8_t front = 1; // consumer owned
+    std::atomic<uint8_t> middle {2};
+    uint32_t posted = 0; // producer owned
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+
+/*
+ * Running median over the last N samples. Rejects single-sample spikes (missed or doubled echoes, I2C glitches)
+ * without the lag of an averaging filter of the same width.
+ */
+template <typename T, size_t N>
+class MedianFilter {
+    static_assert(N > 0, "median window must hold at least one sample");
+
+  public:
+    T push(T sample) {
+        _window[_next] = sample;
+        _next = (_next + 1) % N;
+        if (_count < N) _count++;
+        return value();
+    }
+
+    // Median of the samples seen so far (upper median for an even count), T{} when empty.
+    T value() const {
+        if (!_count) return T {};
+        T sorted[N];
+        std::copy(_window, _window + _count, sorted);
+        std::nth_element(sorted, sorted + _count / 2, sorted + _count);
+        return sorted[_count / 2];
+    }
+
+    size_t size() const { return _count; }
+
+    void reset() {
+        _count = 0;
+        _next = 0;
+    }
+
+  private:
+    T _window[N] {};
+    size_t _next {0};
+    size_t _count {0};
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+
+/*
+ * Fixed capacity ring that keeps the newest N elements, overwriting the oldest when full. Indexing runs from the
+ * oldest element (0) to the newest (size() - 1). Single owner; not safe to share between tasks.
+ */
+template <typename T, size_t N>
+class RingBuffer {
+    static_assert(N > 0, "ring must hold at least one element");
+
+  public:
+    static constexpr size_t capacity() { return N; }
+
+    void push(const T &value) {
+        _items[_head] = value;
+        _head = (_head + 1) % N;
+        if (_count < N) _count++;
+    }
+
+    size_t size() const { return _count; }
+    bool empty() const { return _count == 0; }
+
+    const T &operator[](size_t i) const { return _items[(_head + N - _count + i) % N]; }
+
+    const T &back() const { return _items[(_head + N - 1) % N]; }
+
+    void clear() {
+        _head = 0;
+        _count = 0;
+    }
+
+  private:
+    T _items[N] {};
+    size_t _head {0};
+    size_t _count {0};
+};
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <freertos/FreeRTOS.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+// Tasks a sample can hold. The scheduler reports nothing when it runs more tasks than this.
+#ifndef TASK_STATS_MAX_TASKS
+#define TASK_STATS_MAX_TASKS 32
+#endif
+
+// Default sampling interval, changeable at runtime within TaskStats::MIN_INTERVAL_MS..MAX_INTERVAL_MS.
+#ifndef TASK_STATS_INTERVAL_MS
+#define TASK_STATS_INTERVAL_MS 1000
+#endif
+
+// One task as read from the scheduler (uxTaskGetSystemState on the target).
+struct task_sample_t {
+    uint32_t id;         // xTaskNumber, never reused
+    const char *name;
+    uint32_t runtime;    // run-time counter since the task started, wraps
+    uint32_t stack_free; // stack high-water mark, bytes never used
+    int8_t core;         // -1 when not pinned
+    uint8_t priority;
+};
+
+struct task_usage_t {
+    uint32_t id;
+    char name[configMAX_TASK_NAME_LEN];
+    float cpu_percent; // of one core, over the last interval
+    uint32_t stack_free;
+    int8_t core;
+    uint8_t priority;
+};
+
+/*
+ * Per-task CPU use between two scheduler snapshots. Only the previous snapshot's ids and run-time counters are kept,
+ * sorted by id, so a sample is a sort of the new snapshot and one merge against the old one: no allocation, and the
+ * cost stays flat however long the robot runs. Deltas are taken on the 32-bit counters, right across wraps as long
+ * as samples come more often than the counter wraps (71 minutes at the 1 MHz esp_timer clock).
+ *
+ * A task that was not in the previous snapshot counts from zero, which is exact: it started during the interval.
+ * Likewise the first sample reports averages since boot. Per-core load is what the core's idle task did not use.
+ */
+class TaskStats {
+  public:
+    static constexpr size_t MAX_TASKS = TASK_STATS_MAX_TASKS;
+    static constexpr int CORES = portNUM_PROCESSORS;
+    static constexpr uint32_t MIN_INTERVAL_MS = 250;
+    static constexpr uint32_t MAX_INTERVAL_MS = 60000;
+
+    // total_runtime is the run-time clock when the snapshot was taken. Returns the number of tasks reported.
+    size_t update(const task_sample_t *samples, size_t count, uint32_t total_runtime) {
+        count = std::min(count, MAX_TASKS);
+        const uint32_t elapsed = total_runtime - _total_runtime;
+        _total_runtime = total_runtime;
+
+        uint8_t order[MAX_TASKS];
+        for (size_t i = 0; i < count; i++) order[i] = static_cast<uint8_t>(i);
+        std::sort(order, order + count, [&](uint8_t a, uint8_t b) { return samples[a].id < samples[b].id; });
+
+        float idle[CORES] = {};
+        size_t previous = 0;
+        for (size_t i = 0; i < count; i++) {
+            const task_sample_t &sample = samples[order[i]];
+            while (previous < _count && _ids[previous] < sample.id) previous++;
+            const bool known = previous < _count && _ids[previous] == sample.id;
+            const uint32_t delta = sample.runtime - (known ? _runtimes[previous] : 0);
+
+            task_usage_t &usage = _usage[i];
+            usage.id = sample.id;
+            strncpy(usage.name, sample.name, sizeof(usage.name) - 1);
+            usage.name[sizeof(usage.name) - 1] = '\0';
+            usage.cpu_percent = elapsed ? std::min(100.0f, 100.0f * delta / elapsed) : 0.0f;
+            usage.stack_free = sample.stack_free;
+            usage.core = sample.core;
+            usage.priority = sample.priority;
+
+            const int idle_core = idleCore(sample);
+            if (idle_core >= 0 && idle_core < CORES) idle[idle_core] += usage.cpu_percent;
+        }
+        // Kept for the next sample only after the merge, which still reads the old arrays.
+        for (size_t i = 0; i < count; i++) {
+            _ids[i] = samples[order[i]].id;
+            _runtimes[i] = samples[order[i]].runtime;
+        }
+        _count = count;
+        for (int core = 0; core < CORES; core++) {
+            _core_usage[core] = elapsed ? 100.0f - std::min(idle[core], 100.0f) : 0.0f;
+        }
+        return count;
+    }
+
+    // Tasks of the last sample, in creation order.
+    size_t count() const { return _count; }
+    const task_usage_t &task(size_t i) const { return _usage[i]; }
+
+    float coreUsage(int core) const { return core >= 0 && core < CORES ? _core_usage[core] : 0.0f; }
+
+    float cpuUsage() const {
+        float total = 0;
+        for (float usage : _core_usage) total += usage;
+        return total / CORES;
+    }
+
+  private:
+    // The core an idle task ("IDLE", "IDLE0", "IDLE1") belongs to, or -1 for any other task.
+    static int idleCore(const task_sample_t &sample) {
+        if (std::strncmp(sample.name, "IDLE", 4) != 0) return -1;
+        if (sample.name[4] >= '0' && sample.name[4] <= '9') return sample.name[4] - '0';
+        return sample.core >= 0 ? sample.core : 0;
+    }
+
+    uint32_t _total_runtime {0};
+    size_t _count {0};
+    uint32_t _ids[MAX_TASKS] {};
+    uint32_t _runtimes[MAX_TASKS] {};
+    task_usage_t _usage[MAX_TASKS] {};
+    float _core_usage[CORES] {};
+};
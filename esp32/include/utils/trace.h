@@ -0,0 +1,291 @@
+#pragma once
+
+#include <esp_cpu.h>
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+#include <esp_rom_sys.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+// Compiled out unless the build enables it (features.ini); the host tests use the Tracer directly.
+#ifndef USE_TRACE
+#define USE_TRACE 0
+#endif
+
+// Events per core when the board has PSRAM, 20 bytes each.
+#ifndef TRACE_EVENTS_PER_CORE
+#define TRACE_EVENTS_PER_CORE 8192
+#endif
+
+// Events per core in internal RAM on boards without PSRAM.
+#ifndef TRACE_EVENTS_PER_CORE_INTERNAL
+#define TRACE_EVENTS_PER_CORE_INTERNAL 1024
+#endif
+
+/*
+ * Span and counter tracing across both cores, exported as Chrome trace JSON for Perfetto (ui.perfetto.dev) or
+ * chrome://tracing. A capture runs from start() until stop() or until a core's buffer fills, so the file covers one
+ * window in which every core was recorded.
+ *
+ * Each core appends to its own buffer. A slot is reserved with one atomic add and published by writing its phase
+ * last, so tasks and preemption on the same core never take a lock, and a slot still being written when the capture
+ * stops is simply left out. Timestamps are the core's cycle counter, converted to microseconds at export against
+ * an esp_timer reading taken on that core when it recorded its first event; the CPU clock must stay fixed for the
+ * capture (no dynamic frequency scaling).
+ */
+namespace trace {
+
+enum Phase : uint8_t { EMPTY = 0, BEGIN = 'B', END = 'E', COUNTER = 'C' };
+
+struct event_t {
+    uint32_t cycles;
+    const char *name; // string literal, only the pointer is stored
+    TaskHandle_t task;
+    int32_t value; // counter value, or an argument of a span's begin
+    std::atomic<uint8_t> phase;
+};
+
+class Tracer {
+  public:
+    static constexpr int CORES = portNUM_PROCESSORS;
+    static constexpr size_t MAX_TASKS = 32;
+
+    static Tracer &instance() {
+        static Tracer inst;
+        return inst;
+    }
+
+    ~Tracer() {
+        for (auto &core : _cores) heap_caps_free(core.events);
+    }
+
+    // Allocates the buffers, in PSRAM when the board has it. capacity 0 picks the configured size for the memory.
+    bool begin(size_t capacity = 0) {
+        if (_capacity) return true;
+        const bool psram = heap_caps_get_total_size(MALLOC_CAP_SPIRAM) > 0;
+        if (!capacity) capacity = psram ? TRACE_EVENTS_PER_CORE : TRACE_EVENTS_PER_CORE_INTERNAL;
+        const uint32_t caps = psram ? MALLOC_CAP_SPIRAM : MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+        for (auto &core : _cores) {
+            core.events = static_cast<event_t *>(heap_caps_calloc(capacity, sizeof(event_t), caps));
+            if (!core.events) {
+                ESP_LOGE(TAG, "No memory for %u events per core", static_cast<unsigned>(capacity));
+                for (auto &allocated : _cores) {
+                    heap_caps_free(allocated.events);
+                    allocated.events = nullptr;
+                }
+                return false;
+            }
+        }
+        _capacity = capacity;
+        ESP_LOGI(TAG, "%u events per core in %s", static_cast<unsigned>(capacity), psram ? "PSRAM" : "internal RAM");
+        return true;
+    }
+
+    // Clears the buffers and starts a capture.
+    bool start() {
+        if (!_capacity || running()) return false;
+        for (auto &core : _cores) {
+            for (size_t i = 0; i < _capacity; i++) core.events[i].phase.store(EMPTY, std::memory_order_relaxed);
+            core.head.store(0, std::memory_order_relaxed);
+            core.anchored.store(false, std::memory_order_relaxed);
+        }
+        for (auto &task : _tasks) task.handle.store(nullptr, std::memory_order_relaxed);
+        _task_count.store(0, std::memory_order_relaxed);
+        for (auto &last : _last_task) last.store(noTask(), std::memory_order_relaxed);
+        _running.store(true, std::memory_order_release);
+        ESP_LOGI(TAG, "Capture started");
+        return true;
+    }
+
+    void stop() { _running.store(false, std::memory_order_release); }
+
+    bool running() const { return _running.load(std::memory_order_acquire); }
+
+    // Events recorded by the current or last capture, over all cores.
+    size_t events() const {
+        size_t total = 0;
+        for (const auto &core : _cores) total += std::min(core.head.load(std::memory_order_relaxed), _capacity);
+        return total;
+    }
+
+    void record(Phase phase, const char *name, int32_t value = 0) {
+        if (!_running.load(std::memory_order_relaxed)) return;
+        const int core_id = esp_cpu_get_core_id();
+        const uint32_t cycles = esp_cpu_get_cycle_count();
+        core_t &core = _cores[core_id];
+        const size_t index = core.head.fetch_add(1, std::memory_order_relaxed);
+        if (index >= _capacity) {
+            // The first full buffer ends the capture for every core.
+            _running.store(false, std::memory_order_relaxed);
+            return;
+        }
+        if (!core.anchored.exchange(true, std::memory_order_relaxed)) {
+            core.anchor_us = esp_timer_get_time();
+            core.anchor_cycles = esp_cpu_get_cycle_count();
+        }
+        TaskHandle_t task = xTaskGetCurrentTaskHandle();
+        if (_last_task[core_id].load(std::memory_order_relaxed) != task) registerTask(core_id, task);
+
+        event_t &event = core.events[index];
+        event.cycles = cycles;
+        event.name = name;
+        event.task = task;
+        event.value = value;
+        event.phase.store(phase, std::memory_order_release);
+    }
+
+    /*
+     * Stops the capture and writes it to path as Chrome trace JSON: one thread per task, named after it, with the core
+     * each event ran on in its args. Returns the number of events written, or -1 if the file could not be written.
+     */
+    int exportJson(const char *path) {
+        stop();
+        FILE *file = fopen(path, "w");
+        if (!file) {
+            ESP_LOGE(TAG, "Failed to open %s", path);
+            return -1;
+        }
+        fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+        fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"%s\"}}", PROCESS_NAME);
+        const size_t tasks = std::min(_task_count.load(std::memory_order_acquire), MAX_TASKS);
+        for (size_t i = 0; i < tasks; i++) {
+            fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                    static_cast<unsigned>(i + 1), _tasks[i].name);
+        }
+
+        const uint32_t ticks_per_us = esp_rom_get_cpu_ticks_per_us();
+        int written = 0;
+        for (int core_id = 0; core_id < CORES; core_id++) {
+            const core_t &core = _cores[core_id];
+            const size_t count = std::min(core.head.load(std::memory_order_relaxed), _capacity);
+            // Unwrapped from the anchor one event at a time; events sit in the buffer in about the order they were
+            // stamped, so the signed difference to the previous one is right across 32-bit wraps.
+            uint32_t previous = core.anchor_cycles;
+            int64_t elapsed = 0;
+            for (size_t i = 0; i < count; i++) {
+                const event_t &event = core.events[i];
+                const uint8_t phase = event.phase.load(std::memory_order_acquire);
+                if (phase == EMPTY) continue;
+                elapsed += static_cast<int32_t>(event.cycles - previous);
+                previous = event.cycles;
+                const double ts = core.anchor_us + static_cast<double>(elapsed) / ticks_per_us;
+                fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{",
+                        event.name, phase, ts, static_cast<unsigned>(taskId(event.task)));
+                if (phase == COUNTER) {
+                    fprintf(file, "\"value\":%ld}}", static_cast<long>(event.value));
+                } else if (phase == BEGIN && event.value) {
+                    fprintf(file, "\"core\":%d,\"value\":%ld}}", core_id, static_cast<long>(event.value));
+                } else {
+                    fprintf(file, "\"core\":%d}}", core_id);
+                }
+                written++;
+            }
+        }
+        fprintf(file, "\n]}\n");
+        if (fclose(file) != 0) {
+            ESP_LOGE(TAG, "Failed to write %s", path);
+            return -1;
+        }
+        ESP_LOGI(TAG, "Wrote %d events to %s", written, path);
+        return written;
+    }
+
+  private:
+    static constexpr const char *TAG = "Trace";
+    static constexpr const char *PROCESS_NAME = "spot";
+
+    struct core_t {
+        event_t *events {nullptr};
+        std::atomic<size_t> head {0};
+        std::atomic<bool> anchored {false};
+        int64_t anchor_us {0};
+        uint32_t anchor_cycles {0};
+    };
+
+    struct task_t {
+        std::atomic<TaskHandle_t> handle {nullptr};
+        char name[configMAX_TASK_NAME_LEN] {};
+    };
+
+    Tracer() {
+        for (auto &last : _last_task) last.store(noTask(), std::memory_order_relaxed);
+    }
+    Tracer(const Tracer &) = delete;
+    Tracer &operator=(const Tracer &) = delete;
+
+    /*
+     * Names are copied when a task first records, so the export does not depend on the task still existing. Only
+     * called when the core switched tasks since its last event, and a task runs on one core at a time, so the same
+     * handle is never added twice concurrently.
+     */
+    void registerTask(int core_id, TaskHandle_t task) {
+        _last_task[core_id].store(task, std::memory_order_relaxed);
+        const size_t count = std::min(_task_count.load(std::memory_order_acquire), MAX_TASKS);
+        for (size_t i = 0; i < count; i++) {
+            if (_tasks[i].handle.load(std::memory_order_acquire) == task) return;
+        }
+        const size_t index = _task_count.fetch_add(1, std::memory_order_acq_rel);
+        if (index >= MAX_TASKS) return;
+        strncpy(_tasks[index].name, task ? pcTaskGetName(task) : "main", sizeof(_tasks[index].name) - 1);
+        _tasks[index].handle.store(task, std::memory_order_release);
+    }
+
+    // Never a real handle; the host's one task is nullptr.
+    static TaskHandle_t noTask() { return reinterpret_cast<TaskHandle_t>(~uintptr_t(0)); }
+
+    // 1-based thread id for the export; tasks past MAX_TASKS share id 0.
+    size_t taskId(TaskHandle_t task) const {
+        const size_t count = std::min(_task_count.load(std::memory_order_acquire), MAX_TASKS);
+        for (size_t i = 0; i < count; i++) {
+            if (_tasks[i].handle.load(std::memory_order_relaxed) == task) return i + 1;
+        }
+        return 0;
+    }
+
+    size_t _capacity {0};
+    core_t _cores[CORES];
+    task_t _tasks[MAX_TASKS];
+    std::atomic<size_t> _task_count {0};
+    std::atomic<TaskHandle_t> _last_task[CORES];
+    std::atomic<bool> _running {false};
+};
+
+// Begin on construction, end on destruction, on the task and core that constructed it.
+class Scope {
+  public:
+    explicit Scope(const char *name, int32_t value = 0) : _name(name) {
+        Tracer::instance().record(BEGIN, name, value);
+    }
+    ~Scope() { Tracer::instance().record(END, _name); }
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+  private:
+    const char *_name;
+};
+
+} // namespace trace
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#if USE_TRACE
+#define TRACE_SCOPE(name) trace::Scope TRACE_CONCAT(_trace_scope_, __LINE__)(name)
+#define TRACE_SCOPE_VALUE(name, value) trace::Scope TRACE_CONCAT(_trace_scope_, __LINE__)(name, value)
+#define TRACE_BEGIN(name) trace::Tracer::instance().record(trace::BEGIN, name)
+#define TRACE_END(name) trace::Tracer::instance().record(trace::END, name)
+#define TRACE_COUNTER(name, value) trace::Tracer::instance().record(trace::COUNTER, name, static_cast<int32_t>(value))
+#else
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_SCOPE_VALUE(name, value) ((void)0)
+#define TRACE_BEGIN(name) ((void)0)
+#define TRACE_END(name) ((void)0)
+#define TRACE_COUNTER(name, value) ((void)0)
+#endif
@@ -20,8 +20,10 @@ void printFeatureConfiguration() {
     ESP_LOGI("Features", "USE_WS2812: %s", USE_WS2812 ? "enabled" : "disabled");
 
     ESP_LOGI("Features", "USE_MDNS: %s", USE_MDNS ? "enabled" : "disabled");
+    ESP_LOGI("Features", "USE_TRACE: %s", USE_TRACE ? "enabled" : "disabled");
     ESP_LOGI("Features", "EMBED_WEBAPP: %s", EMBED_WEBAPP ? "enabled" : "disabled");
     ESP_LOGI("Features", "KINEMATICS_VARIANT: %s", KINEMATICS_VARIANT_STR);
+    ESP_LOGI("Features", "KINEMATICS_FAST_MATH: %s", KINEMATICS_FAST_MATH ? "enabled" : "disabled");
     ESP_LOGI("Features", "==========================================================");
 }
 
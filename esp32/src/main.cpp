@@ -20,6 +20,13 @@
 #include <ap_service.h>
 #include <mdns_service.h>
 #include <system_service.h>
+#include <utils/loop_profiler.h>
+#include <utils/loop_timer.h>
+#include <utils/command_log.h>
+#include <utils/flight_recorder.h>
+#include <utils/trace.h>
+#include <utils/task_stats.h>
+#include <atomic>
 
 #if CONFIG_IDF_TARGET_ESP32P4
 #include <esp_hosted.h>
@@ -32,6 +39,9 @@ Websocket wsSocket {server, "/api/ws"};
 Peripherals peripherals;
 ServoController servoController;
 MotionService motionService;
+command_log::Recorder commandRecorder;
+static char commandRecordingPath[48] = "";
+flight_recorder::Recorder flightRecorder;
 #if FT_ENABLED(USE_WS2812)
 LEDService ledService;
 #endif
@@ -45,6 +55,142 @@ MDNSService mdnsService;
 WiFiService wifiService;
 APService apService;
 
+enum ControlStage { STAGE_PERIPHERALS, STAGE_MOTION, STAGE_SERVO_ANGLES, STAGE_SERVO_UPDATE, STAGE_LED, STAGE_COUNT };
+static constexpr const char *controlStageNames[STAGE_COUNT] = {"peripherals", "motion", "servo_angles",
+                                                                "servo_update", "led"};
+// Requested control rate, applied by the control task before its next tick.
+static std::atomic<uint32_t> controlLoopHz {CONTROL_LOOP_HZ};
+// One report per second of control ticks.
+LoopProfiler<STAGE_COUNT> controlProfiler {controlStageNames, LoopTimer::periodForRate(CONTROL_LOOP_HZ),
+                                           1000000 / LoopTimer::periodForRate(CONTROL_LOOP_HZ)};
+
+static void toProto(const timing_summary_t &summary, socket_message_TimingSummary &proto) {
+    proto.min_us = summary.min_us;
+    proto.avg_us = summary.avg_us;
+    proto.p99_us = summary.p99_us;
+    proto.max_us = summary.max_us;
+}
+
+static void emitLoopTiming() {
+    const auto *report = controlProfiler.takeReport();
+    if (!report || !wsSocket.hasSubscribers(socket_message_Message_loop_timing_tag)) return;
+    socket_message_LoopTimingData data = socket_message_LoopTimingData_init_zero;
+    data.period_us = report->value.period_us;
+    data.ticks = report->value.ticks;
+    data.overruns = report->value.overruns;
+    data.stages_count = STAGE_COUNT;
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        data.stages[i].name = (char *)controlProfiler.stageName(i);
+        data.stages[i].has_timing = true;
+        toProto(report->value.stages[i], data.stages[i].timing);
+    }
+    data.has_busy = true;
+    toProto(report->value.busy, data.busy);
+    data.has_jitter = true;
+    toProto(report->value.jitter, data.jitter);
+    wsSocket.emit(data);
+}
+
+// Requested TaskStatsData interval.
+static std::atomic<uint32_t> taskStatsIntervalMs {TASK_STATS_INTERVAL_MS};
+
+// Samples the scheduler every interval, whether or not anyone streams task stats, so AnalyticsData's CPU load is
+// always current and every delta spans one interval.
+static void emitTaskStats() {
+    static int64_t lastSample = 0;
+    const uint32_t interval_ms = taskStatsIntervalMs.load(std::memory_order_relaxed);
+    const int64_t now = esp_timer_get_time();
+    if (lastSample && now - lastSample < interval_ms * 1000LL) return;
+    lastSample = now;
+    if (!system_service::sampleTasks() || !wsSocket.hasSubscribers(socket_message_Message_task_stats_tag)) return;
+    socket_message_TaskStatsData data = socket_message_TaskStatsData_init_zero;
+    data.interval_ms = interval_ms;
+    system_service::getTaskStats(data);
+    wsSocket.emit(data);
+}
+
+// First unused recordings/<prefix>_NNN.<extension>.
+static bool nextRecordingPath(const char *prefix, const char *extension, char *path, size_t size) {
+    FileSystem::mkdirRecursive(RECORDINGS_DIRECTORY);
+    for (int i = 0; i < 1000; i++) {
+        snprintf(path, size, RECORDINGS_DIRECTORY "/%s_%03d.%s", prefix, i, extension);
+        if (!FileSystem::fileExists(path)) return true;
+    }
+    return false;
+}
+
+static bool startCommandRecording() {
+    return nextRecordingPath("commands", "bin", commandRecordingPath, sizeof(commandRecordingPath)) &&
+           commandRecorder.start(commandRecordingPath);
+}
+
+// One flight recorder entry for the tick that woke at `wake`, taken once the tick's work is done.
+static flight_recorder::record_t flightRecord(int64_t wake, float dt, uint32_t missed) {
+    flight_recorder::record_t record;
+    record.time_us = static_cast<uint32_t>(wake);
+    record.dt_us = flight_recorder::saturate16(std::lround(dt * 1e6f));
+    record.busy_us = flight_recorder::saturate16(esp_timer_get_time() - wake);
+    record.mode = static_cast<uint8_t>(motionService.mode());
+    record.missed = static_cast<uint8_t>(std::min<uint32_t>(missed, UINT8_MAX));
+    const body_state_t &body = motionService.bodyState();
+    const float pose[6] = {body.omega, body.phi, body.psi, body.xm, body.ym, body.zm};
+    std::copy(pose, pose + 6, record.body);
+    for (int leg = 0; leg < 4; leg++) std::copy(body.feet[leg], body.feet[leg] + 3, record.feet[leg]);
+    for (int i = 0; i < 12; i++) {
+        record.target[i] = flight_recorder::centidegrees(motionService.getTargetAngles()[i]);
+        record.angles[i] = flight_recorder::centidegrees(motionService.getAngles()[i]);
+    }
+    record.imu[0] = flight_recorder::imuCentidegrees(peripherals.angleX());
+    record.imu[1] = flight_recorder::imuCentidegrees(peripherals.angleY());
+    record.imu[2] = flight_recorder::imuCentidegrees(peripherals.angleZ());
+    return record;
+}
+
+// Service task: writes a frozen flight recorder out and tells subscribers where to download it.
+static void dumpFlightRecorder() {
+    static char path[48];
+    const auto trigger = flightRecorder.trigger();
+    const uint32_t records = flightRecorder.records();
+    // Dumping re-arms the recorder even when no file name is left, so a full directory cannot stall it frozen.
+    if (!nextRecordingPath("flight", "bin", path, sizeof(path))) path[0] = '\0';
+    if (!flightRecorder.dump(path)) return;
+    if (!wsSocket.hasSubscribers(socket_message_Message_flight_recorder_dump_tag)) return;
+    socket_message_FlightRecorderDump dump = socket_message_FlightRecorderDump_init_zero;
+    strncpy(dump.path, path, sizeof(dump.path) - 1);
+    dump.trigger = (char *)flight_recorder::Recorder::triggerName(trigger);
+    dump.records = records;
+    wsSocket.emit(dump);
+}
+
+// Starts a trace capture, or ends it and exports it for download. Without USE_TRACE there is nothing to capture.
+static void handleTraceCapture(const socket_message_TraceCapture &request, socket_message_TraceCaptureStatus &status,
+                               uint32_t &status_code) {
+#if FT_ENABLED(USE_TRACE)
+    static char path[48] = "";
+    static bool exported = true;
+    trace::Tracer &tracer = trace::Tracer::instance();
+    if (request.capture) {
+        if (!tracer.running() && tracer.start()) {
+            exported = false;
+        } else if (!tracer.running()) {
+            status_code = 500;
+        }
+    } else if (!exported) {
+        // A capture that filled its buffer has already stopped and is exported here all the same.
+        exported = true;
+        if (!nextRecordingPath("trace", "json", path, sizeof(path)) || tracer.exportJson(path) < 0) {
+            path[0] = '\0';
+            status_code = 500;
+        }
+    }
+    status.capturing = tracer.running();
+    strncpy(status.path, path, sizeof(status.path) - 1);
+    status.events = tracer.events();
+#else
+    status_code = 501;
+#endif
+}
+
 void setupServer() {
     server.config(50 + WWW_ASSETS_COUNT, 16384);
     server.listen(80);
@@ -142,7 +288,8 @@ void setupEventSocket() {
     wsSocket.on<socket_message_ModeData>([&](const socket_message_ModeData &data, int clientId) {
         servoController.setMode(SERVO_CONTROL_STATE::ANGLE);
         motionService.handleMode(data);
-        motionService.isActive() ? servoController.activate() : servoController.deactivate();
+        MotionService::isActiveMode(static_cast<MOTION_STATE>(data.mode)) ? servoController.activate()
+                                                                           : servoController.deactivate();
     });
 
     wsSocket.on<socket_message_WalkGaitData>(
@@ -151,6 +298,16 @@ void setupEventSocket() {
     wsSocket.on<socket_message_AnglesData>(
         [&](const socket_message_AnglesData &data, int clientId) { motionService.handleAngles(data); });
 
+    wsSocket.on<socket_message_ControlLoopRateData>(
+        [&](const socket_message_ControlLoopRateData &data, int clientId) { controlLoopHz.store(data.rate_hz); });
+
+    wsSocket.on<socket_message_TaskStatsIntervalData>([&](const socket_message_TaskStatsIntervalData &data, int) {
+        taskStatsIntervalMs.store(std::clamp(data.interval_ms, TaskStats::MIN_INTERVAL_MS, TaskStats::MAX_INTERVAL_MS));
+    });
+
+    wsSocket.on<socket_message_FlightRecorderFreeze>(
+        [&](const socket_message_FlightRecorderFreeze &data, int clientId) { flightRecorder.freeze(); });
+
     wsSocket.on<socket_message_ServoPWMData>([&](const socket_message_ServoPWMData &data, int clientId) {
         servoController.setServoPWM(data.servo_id, data.servo_pwm);
     });
@@ -184,6 +341,38 @@ void setupEventSocket() {
              res.response.imu_calibrate_data.success = peripherals.calibrateIMU();
          }},
 
+        {socket_message_CorrelationRequest_servo_calibration_capture_tag,
+         [](const auto &req, auto &res, int clientId) {
+             res.which_response = socket_message_CorrelationResponse_servo_calibration_result_tag;
+             const auto &capture = req.request.servo_calibration_capture;
+             const int points = capture.clear
+                                    ? servoController.clearCalibration(capture.servo_id)
+                                    : servoController.captureCalibrationPoint(capture.servo_id, capture.angle);
+             res.response.servo_calibration_result.success = points >= 0;
+             res.response.servo_calibration_result.points = std::max(points, 0);
+         }},
+
+        {socket_message_CorrelationRequest_command_recording_tag,
+         [](const auto &req, auto &res, int clientId) {
+             res.which_response = socket_message_CorrelationResponse_command_recording_status_tag;
+             if (req.request.command_recording.record && !commandRecorder.recording()) {
+                 if (!startCommandRecording()) res.status_code = 500;
+             } else if (!req.request.command_recording.record) {
+                 commandRecorder.stop();
+             }
+             auto &status = res.response.command_recording_status;
+             status.recording = commandRecorder.recording();
+             strncpy(status.path, commandRecordingPath, sizeof(status.path) - 1);
+             status.bytes = commandRecorder.bytes();
+             status.dropped = commandRecorder.dropped();
+         }},
+
+        {socket_message_CorrelationRequest_trace_capture_tag,
+         [](const auto &req, auto &res, int clientId) {
+             res.which_response = socket_message_CorrelationResponse_trace_capture_status_tag;
+             handleTraceCapture(req.request.trace_capture, res.response.trace_capture_status, res.status_code);
+         }},
+
         {socket_message_CorrelationRequest_system_information_request_tag,
          [](const auto &req, auto &res, int clientId) {
              res.which_response = socket_message_CorrelationResponse_system_information_response_tag;
@@ -255,27 +444,56 @@ void setupEventSocket() {
 
 void IRAM_ATTR SpotControlLoopEntry(void *) {
     ESP_LOGI("main", "Control task starting");
-    TickType_t xLastWakeTime = xTaskGetTickCount();
-    const TickType_t xFrequency = pdMS_TO_TICKS(10);
 
     peripherals.begin();
     servoController.begin();
     motionService.begin();
+    motionService.setRecorder(&commandRecorder);
 #if FT_ENABLED(USE_WS2812)
     ledService.begin();
 #endif
     peripherals.calibrateIMU();
+    // Sensor reads block on I2C, keep them on the other core.
+    peripherals.startSensorTask(0, 4);
+
+    flightRecorder.begin();
+
+    LoopTimer loopTimer;
+    ESP_ERROR_CHECK(loopTimer.start(controlLoopHz.load(std::memory_order_relaxed)));
+    uint32_t reportedMisses = 0;
+    uint32_t recordedMisses = 0;
 
     for (;;) {
-        WARN_IF_SLOW(SpotControlLoopEntry, 10);
+        const float dt = loopTimer.wait();
+        TRACE_SCOPE("control tick");
+        const uint32_t rateHz = controlLoopHz.load(std::memory_order_relaxed);
+        if (LoopTimer::periodForRate(rateHz) != loopTimer.periodUs() && loopTimer.setRate(rateHz) == ESP_OK) {
+            controlProfiler.setPeriod(loopTimer.periodUs(), loopTimer.rateHz());
+        }
+        controlProfiler.beginTick(loopTimer.lastWake());
         peripherals.update();
-        motionService.update(&peripherals);
+        controlProfiler.mark(STAGE_PERIPHERALS);
+        motionService.update(&peripherals, dt);
+        controlProfiler.mark(STAGE_MOTION);
         servoController.setAngles(motionService.getAngles());
+        controlProfiler.mark(STAGE_SERVO_ANGLES);
         servoController.update();
+        controlProfiler.mark(STAGE_SERVO_UPDATE);
 #if FT_ENABLED(USE_WS2812)
         ledService.loop();
 #endif
-        vTaskDelayUntil(&xLastWakeTime, xFrequency);
+        controlProfiler.mark(STAGE_LED);
+        controlProfiler.endTick();
+        flightRecorder.record(flightRecord(loopTimer.lastWake(), dt, loopTimer.missed() - recordedMisses));
+        recordedMisses = loopTimer.missed();
+        if (loopTimer.missed() != reportedMisses) {
+            EXECUTE_EVERY_N_MS(1000, {
+                ESP_LOGW("main", "Control loop missed %u ticks at %u Hz",
+                         static_cast<unsigned>(loopTimer.missed() - reportedMisses),
+                         static_cast<unsigned>(loopTimer.rateHz()));
+                reportedMisses = loopTimer.missed();
+            });
+        }
     }
 }
 
@@ -314,6 +532,7 @@ void IRAM_ATTR serviceLoopEntry(void *) {
     ESP_LOGI("main", "Service task started");
 
     for (;;) {
+        TRACE_BEGIN("service loop");
         wifiService.loop();
         apService.loop();
 
@@ -338,8 +557,16 @@ void IRAM_ATTR serviceLoopEntry(void *) {
             }
         });
 
+        emitLoopTiming();
+        emitTaskStats();
+
+        commandRecorder.flush();
+        if (flightRecorder.frozen()) dumpFlightRecorder();
+
         EXECUTE_EVERY_N_MS(60000, { FileSystemWS::fsHandler.cleanupExpiredTransfers(); });
 
+        TRACE_COUNTER("free heap", esp_get_free_heap_size());
+        TRACE_END("service loop");
         vTaskDelay(100 / portTICK_PERIOD_MS);
     }
 }
@@ -353,6 +580,9 @@ extern "C" void app_main(void) {
     ESP_ERROR_CHECK(ret);
 
     FileSystem::init();
+#if FT_ENABLED(USE_TRACE)
+    trace::Tracer::instance().begin();
+#endif
 
     ESP_LOGI("main", "Booting robot");
 
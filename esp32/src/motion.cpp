@@ -1,10 +1,21 @@
 #include <motion.h>
 
-void MotionService::begin() { body_state.updateFeet(KinConfig::default_feet_positions); }
+void MotionService::begin() {
+    body_state.updateFeet(KinConfig::default_feet_positions);
+    trajectory.reset(angles);
+    applyJointLimits();
+}
 
 void MotionService::handleAngles(const socket_message_AnglesData& data) {
+    if (recorder) recorder->recordAngles(data.angles, data.angles_count);
     for (int i = 0; i < 12 && i < data.angles_count; i++) {
-        angles[i] = data.angles[i];
+        target_angles[i] = data.angles[i];
+    }
+}
+
+void MotionService::applyJointLimits() {
+    for (int i = 0; i < 12; i++) {
+        trajectory.setLimits(i, state ? state->jointLimits(i) : MotionState::postureLimits());
     }
 }
 
@@ -16,42 +27,88 @@ void MotionService::setState(MotionState* newState) {
     if (state) {
         state->begin();
     }
+    applyJointLimits();
 }
 
 void MotionService::handleInput(const socket_message_ControllerData& data) {
-    command.fromProto(data);
-    if (state) state->handleCommand(command);
+    last_posted.fromProto(data);
+    if (recorder) recorder->recordInput(last_posted);
+    commands.post(last_posted);
 }
 
 void MotionService::onControlLinkLost() {
-    command.lx = command.ly = command.rx = command.ry = command.s = 0;
-    if (state) state->handleCommand(command);
+    // Keep height and gait settings from the last command that reached the producer side.
+    CommandMsg msg = last_posted;
+    msg.lx = msg.ly = msg.rx = msg.ry = msg.s = 0;
+    if (recorder) recorder->recordLinkLost();
+    commands.post(msg);
     ESP_LOGW("MotionService", "Control link lost — locomotion stopped");
 }
 
+void MotionService::applyPendingCommand(int64_t now) {
+    const auto* msg = commands.take();
+    if (!msg) return;
+    command = msg->value;
+    command_latency = now - msg->timestamp;
+    dropped_commands += msg->sequence - last_command_sequence - 1;
+    last_command_sequence = msg->sequence;
+    if (state) state->handleCommand(command);
+}
+
 void MotionService::handleWalkGait(const socket_message_WalkGaitData& data) {
     ESP_LOGI("MotionService", "Walk Gait %d", static_cast<int>(data.gait));
-    if (data.gait == socket_message_WalkGaits_TROT)
-        walkState.set_mode_trot();
-    else
-        walkState.set_mode_crawl();
+    if (recorder) recorder->recordWalkGait(data.gait);
+    last_requested.gait = data.gait;
+    last_requested.gait_sequence++;
+    requests.post(last_requested);
 }
 
 void MotionService::handleMode(const socket_message_ModeData& data) {
     MOTION_STATE mode = static_cast<MOTION_STATE>(data.mode);
     ESP_LOGV("MotionService", "Mode %d", static_cast<int>(mode));
-    switch (mode) {
-        case MOTION_STATE::REST: setState(&restState); break;
-        case MOTION_STATE::STAND: setState(&standState); break;
-        case MOTION_STATE::WALK: setState(&walkState); break;
-        case MOTION_STATE::DEACTIVATED: setState(nullptr); break;
-        default: setState(nullptr); break;
+    if (recorder) recorder->recordMode(data.mode);
+    last_requested.mode = mode;
+    last_requested.mode_sequence++;
+    requests.post(last_requested);
+}
+
+bool MotionService::isActiveMode(MOTION_STATE mode) {
+    return mode == MOTION_STATE::REST || mode == MOTION_STATE::STAND || mode == MOTION_STATE::WALK;
+}
+
+void MotionService::applyPendingRequest() {
+    const auto* msg = requests.take();
+    if (!msg) return;
+    const motion_request_t& request = msg->value;
+    if (request.gait_sequence != applied_gait_sequence) {
+        applied_gait_sequence = request.gait_sequence;
+        if (request.gait == socket_message_WalkGaits_TROT)
+            walkState.set_mode_trot();
+        else
+            walkState.set_mode_crawl();
+    }
+    if (request.mode_sequence != applied_mode_sequence) {
+        applied_mode_sequence = request.mode_sequence;
+        switch (request.mode) {
+            case MOTION_STATE::REST: setState(&restState); break;
+            case MOTION_STATE::STAND: setState(&standState); break;
+            case MOTION_STATE::WALK: setState(&walkState); break;
+            default: setState(nullptr); break;
+        }
     }
 }
 
+MOTION_STATE MotionService::mode() const {
+    if (state == &restState) return MOTION_STATE::REST;
+    if (state == &standState) return MOTION_STATE::STAND;
+    if (state == &walkState) return MOTION_STATE::WALK;
+    return MOTION_STATE::DEACTIVATED;
+}
+
 void MotionService::handleGestures(const gesture_t ges) {
     if (ges != gesture_t::eGestureNone) {
         ESP_LOGI("Motion", "Gesture: %d", ges);
+        if (recorder) recorder->recordGesture(ges);
         switch (ges) {
             case gesture_t::eGestureDown: setState(&restState); break;
             case gesture_t::eGestureUp: setState(&standState); break;
@@ -64,26 +121,33 @@ void MotionService::handleGestures(const gesture_t ges) {
 }
 
 bool MotionService::update(Peripherals* peripherals) {
+    return update(peripherals, (esp_timer_get_time() - lastUpdate) / 1000000.0f);
+}
+
+bool MotionService::update(Peripherals* peripherals, float dt) {
+    applyPendingRequest();
     handleGestures(peripherals->takeGesture());
-    if (!state) return false;
     int64_t now = esp_timer_get_time();
-    float dt = (now - lastUpdate) / 1000000.0f; // Convert microseconds to seconds
+    applyPendingCommand(now);
     lastUpdate = now;
-    state->updateImuOffsets(peripherals->angleY(), peripherals->angleX());
-    state->step(body_state, dt);
-    kinematics.calculate_inverse_kinematics(body_state, new_angles);
+    if (state) {
+        state->updateImuOffsets(peripherals->angleY(), peripherals->angleX());
+        state->step(body_state, dt);
+        kinematics.calculate_inverse_kinematics(body_state, new_angles);
+        for (int i = 0; i < 12; i++) target_angles[i] = new_angles[i] * dir[i];
+    }
+    // The one place joint motion is shaped: velocity and acceleration limited over the measured dt.
+    trajectory.update(target_angles, dt);
 
-    return update_angles(new_angles, angles);
+    return update_angles(trajectory.positions(), angles);
 }
 
-bool MotionService::update_angles(float new_angles[12], float angles[12]) {
+bool MotionService::update_angles(const float new_angles[12], float angles[12]) {
     bool updated = false;
     for (int i = 0; i < 12; i++) {
-        const float new_angle = new_angles[i] * dir[i];
-        if (!isEqual(new_angle, angles[i], 0.1)) {
-            angles[i] = new_angle;
-            updated = true;
-        }
+        // The threshold only decides whether the change is worth reporting; the output always follows the trajectory.
+        updated |= !isEqual(new_angles[i], angles[i], 0.1);
+        angles[i] = new_angles[i];
     }
     return updated;
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include <peripherals/camera_service.h>
 #include <communication/webserver.h>
 #include <esp_heap_caps.h>
+#include <utils/trace.h>
 
 namespace Camera {
 
@@ -17,6 +18,7 @@ static constexpr const char *_STREAM_PART = "Content-Type: image/jpeg\r\nContent
 SemaphoreHandle_t cameraMutex = xSemaphoreCreateMutex();
 
 camera_fb_t *safe_camera_fb_get() {
+    TRACE_SCOPE("camera frame");
     camera_fb_t *fb = NULL;
     if (xSemaphoreTakeRecursive(cameraMutex, portMAX_DELAY) == pdTRUE) {
         fb = esp_camera_fb_get();
@@ -277,6 +279,7 @@ static bool on_trans_finished(esp_cam_ctlr_handle_t handle, esp_cam_ctlr_trans_t
 
 static void capture_task_fn(void *arg) {
     while (s_capture_running) {
+        TRACE_SCOPE("camera frame");
         int idx = s_write_idx;
 
         esp_cam_ctlr_trans_t trans = {};
@@ -6,7 +6,7 @@ Peripherals::Peripherals()
                     API_RESPONSE_ASSIGNER(peripheral_settings, api_PeripheralSettings)),
       _persistence(PeripheralsConfiguration_read, PeripheralsConfiguration_update, this, PERIPHERAL_SETTINGS_FILE,
                    api_PeripheralSettings_fields, api_PeripheralSettings_size, PeripheralsConfiguration_defaults()) {
-    _accessMutex = xSemaphoreCreateMutex();
+    _accessMutex = xSemaphoreCreateRecursiveMutex();
     addUpdateHandler([&](const std::string &originId) { updatePins(); }, false);
 }
 
@@ -28,17 +28,54 @@ void Peripherals::begin() {
     if (!_gesture.initialize()) ESP_LOGE("Peripherals", "Gesture sensor initialize failed");
 #endif
 #if FT_ENABLED(USE_USS)
-    _left_sonar = std::make_unique<NewPing>(USS_LEFT_PIN, USS_LEFT_PIN, MAX_DISTANCE);
-    _right_sonar = std::make_unique<NewPing>(USS_RIGHT_PIN, USS_RIGHT_PIN, MAX_DISTANCE);
+    if (!_sonar.initialize(USS_LEFT_PIN, USS_LEFT_ECHO_PIN, USS_RIGHT_PIN, USS_RIGHT_ECHO_PIN, MAX_DISTANCE))
+        ESP_LOGE("Peripherals", "Sonar initialize failed");
 #endif
 };
 
+void Peripherals::startSensorTask(BaseType_t core, UBaseType_t priority) {
+    if (_sensor_task) return;
+    xTaskCreatePinnedToCore(sensorTaskEntry, "Sensor task", 4096, this, priority, &_sensor_task, core);
+    // Serves the sensor reads queued on the bus, below the sensor task so they never delay its IMU reads.
+    I2CBus::instance().startWorker(core, priority > 1 ? priority - 1 : 1);
+#if FT_ENABLED(USE_MPU6050 || USE_BNO055)
+    _imu.setReader(_sensor_task);
+#endif
+}
+
+void Peripherals::sensorTaskEntry(void *arg) {
+    auto *self = static_cast<Peripherals *>(arg);
+    ESP_LOGI("Peripherals", "Sensor task starting");
+    for (;;) {
+        self->acquire();
+        // An IMU data-ready interrupt wakes the task early; everything else runs off the period.
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(SENSOR_TASK_PERIOD_MS));
+    }
+}
+
+void Peripherals::acquire() {
+    bool updated = false;
+#if FT_ENABLED(USE_MPU6050 || USE_BNO055)
+    if (_imu.isInterruptDriven())
+        updated |= readImu();
+    else
+        EXECUTE_EVERY_N_MS(20, { updated |= readImu(); });
+#endif
+    EXECUTE_EVERY_N_MS(100, { updated |= readMag(); });
+    EXECUTE_EVERY_N_MS(100, { updated |= readGesture(); });
+    // The barometer and sonar drivers are state machines that never wait, so they are polled every tick.
+    updated |= readBMP();
+    updated |= readSonar();
+    if (!updated) return;
+    _snapshots.post(_acquired);
+    beginTransaction();
+    _published = _acquired;
+    endTransaction();
+}
+
 void Peripherals::update() {
-    EXECUTE_EVERY_N_MS(20, { readImu(); });
-    EXECUTE_EVERY_N_MS(100, { readMag(); });
-    EXECUTE_EVERY_N_MS(100, { readGesture(); });
-    EXECUTE_EVERY_N_MS(500, { readBMP(); });
-    EXECUTE_EVERY_N_MS(500, { readSonar(); });
+    if (!_sensor_task) acquire();
+    if (const auto *msg = _snapshots.take()) _snapshot = msg->value;
 }
 
 void Peripherals::updatePins() {
@@ -54,10 +91,25 @@ void Peripherals::updatePins() {
 }
 
 void Peripherals::getI2CScanProto(socket_message_I2CScanData &data) {
+    i2c_device_stats_t stats[16];
+    const size_t stats_count = I2CBus::instance().deviceStats(stats, 16);
     data.devices_count = 0;
     for (auto &address : _address_list) {
         if (data.devices_count >= 16) break;
-        data.devices[data.devices_count].address = address;
+        socket_message_I2CDevice &device = data.devices[data.devices_count];
+        device.address = address;
+        for (size_t i = 0; i < stats_count; i++) {
+            if (stats[i].address != address) continue;
+            device.has_stats = true;
+            device.stats.transactions = stats[i].transactions;
+            device.stats.errors = stats[i].errors;
+            device.stats.expired = stats[i].expired;
+            device.stats.bytes_written = stats[i].bytes_written;
+            device.stats.bytes_read = stats[i].bytes_read;
+            device.stats.avg_latency_us =
+                stats[i].transactions ? static_cast<uint32_t>(stats[i].total_latency_us / stats[i].transactions) : 0;
+            device.stats.max_latency_us = stats[i].max_latency_us;
+        }
         data.devices_count++;
     }
 }
@@ -72,21 +124,25 @@ void Peripherals::scanI2C(uint8_t lower, uint8_t higher) {
     ESP_LOGI("Peripherals", "Scan complete - Found %d device(s)", devices.size());
 }
 
+// Called from the service task, so it reads the published copy rather than the drivers the sensor task is updating.
 void Peripherals::getIMUProto(socket_message_IMUData &data) {
+    beginTransaction();
+    const sensor_snapshot_t snapshot = _published;
+    endTransaction();
 #if FT_ENABLED(USE_MPU6050 || USE_BNO055)
-    data.x = _imu.getAngleX();
-    data.y = _imu.getAngleY();
-    data.z = _imu.getAngleZ();
+    data.x = snapshot.angles[0];
+    data.y = snapshot.angles[1];
+    data.z = snapshot.angles[2];
 #endif
 #if FT_ENABLED(USE_HMC5883)
-    data.heading = _mag.getHeading();
+    data.heading = snapshot.heading;
 #elif FT_ENABLED(USE_MPU6050)
-    data.heading = _imu.getAngleZ();
+    data.heading = snapshot.angles[2];
 #endif
 #if FT_ENABLED(USE_BMP180)
-    data.altitude = _bmp.getAltitude();
-    data.bmp_temp = _bmp.getTemperature();
-    data.pressure = _bmp.getPressure();
+    data.altitude = snapshot.altitude;
+    data.bmp_temp = snapshot.temperature;
+    data.pressure = snapshot.pressure;
 #endif
 }
 
@@ -104,6 +160,12 @@ bool Peripherals::readImu() {
     beginTransaction();
     updated = _imu.update();
     endTransaction();
+    if (updated) {
+        _acquired.imu_time = _imu.getSampleTime();
+        _acquired.angles[0] = _imu.getAngleX();
+        _acquired.angles[1] = _imu.getAngleY();
+        _acquired.angles[2] = _imu.getAngleZ();
+    }
 #endif
     return updated;
 }
@@ -114,6 +176,10 @@ bool Peripherals::readMag() {
     beginTransaction();
     updated = _mag.update();
     endTransaction();
+    if (updated) {
+        _acquired.mag_time = esp_timer_get_time();
+        _acquired.heading = _mag.getHeading();
+    }
 #endif
     return updated;
 }
@@ -124,6 +190,12 @@ bool Peripherals::readBMP() {
     beginTransaction();
     updated = _bmp.update();
     endTransaction();
+    if (updated) {
+        _acquired.bmp_time = esp_timer_get_time();
+        _acquired.altitude = _bmp.getAltitude();
+        _acquired.temperature = _bmp.getTemperature();
+        _acquired.pressure = _bmp.getPressure();
+    }
 #endif
     return updated;
 }
@@ -134,56 +206,41 @@ bool Peripherals::readGesture() {
     beginTransaction();
     updated = _gesture.readGesture();
     endTransaction();
+    if (updated) {
+        _acquired.gesture = _gesture.takeGesture();
+        _acquired.gesture_count++;
+    }
 #endif
     return updated;
 }
 
-void Peripherals::readSonar() {
+// Echoes are timed in the GPIO interrupt; this only collects a finished ping and fires the next one.
+bool Peripherals::readSonar() {
+    bool updated = false;
 #if FT_ENABLED(USE_USS)
-    _left_distance = _left_sonar->ping_cm();
-    vTaskDelay(50 / portTICK_PERIOD_MS);
-    _right_distance = _right_sonar->ping_cm();
+    updated = _sonar.update();
+    if (updated) {
+        _acquired.left_sonar = _sonar.reading(SonarPair<HCSR04Driver>::LEFT);
+        _acquired.right_sonar = _sonar.reading(SonarPair<HCSR04Driver>::RIGHT);
+    }
 #endif
+    return updated;
 }
 
-float Peripherals::angleX() {
-    return
-#if FT_ENABLED(USE_MPU6050 || USE_BNO055)
-        _imu.getAngleX();
-#else
-        0;
-#endif
-}
+float Peripherals::angleX() { return _snapshot.angles[0]; }
 
-float Peripherals::angleY() {
-    return
-#if FT_ENABLED(USE_MPU6050 || USE_BNO055)
-        _imu.getAngleY();
-#else
-        0;
-#endif
-}
+float Peripherals::angleY() { return _snapshot.angles[1]; }
 
-float Peripherals::angleZ() {
-    return
-#if FT_ENABLED(USE_MPU6050 || USE_BNO055)
-        _imu.getAngleZ();
-#else
-        0;
-#endif
-}
+float Peripherals::angleZ() { return _snapshot.angles[2]; }
 
 gesture_t Peripherals::takeGesture() {
-    return
-#if FT_ENABLED(USE_PAJ7620U2)
-        _gesture.takeGesture();
-#else
-        gesture_t::eGestureNone;
-#endif
+    if (_snapshot.gesture_count == _gestures_taken) return gesture_t::eGestureNone;
+    _gestures_taken = _snapshot.gesture_count;
+    return _snapshot.gesture;
 }
 
-float Peripherals::leftDistance() { return _left_distance; }
-float Peripherals::rightDistance() { return _right_distance; }
+sonar_reading_t Peripherals::leftDistance() { return _snapshot.left_sonar; }
+sonar_reading_t Peripherals::rightDistance() { return _snapshot.right_sonar; }
 
 bool Peripherals::calibrateIMU() {
 #if FT_ENABLED(USE_MPU6050 || USE_BNO055)
@@ -7,6 +7,8 @@
 #include <esp_system.h>
 #include <esp_sleep.h>
 #include <soc/soc.h>
+#include <cmath>
+#include <utils/task_stats.h>
 
 #if CONFIG_IDF_TARGET_ESP32S2 || CONFIG_IDF_TARGET_ESP32S3 || CONFIG_IDF_TARGET_ESP32C3 || \
     CONFIG_IDF_TARGET_ESP32C6 || CONFIG_IDF_TARGET_ESP32P4
@@ -209,6 +211,50 @@ void getStaticSystemInformation(socket_message_StaticSystemInformation &info) {
     info.cpu_reset_reason = (char *)resetReason(esp_reset_reason());
 }
 
+static TaskStats taskStats;
+
+bool sampleTasks() {
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY && CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    static TaskStatus_t status[TaskStats::MAX_TASKS];
+    static task_sample_t samples[TaskStats::MAX_TASKS];
+    configRUN_TIME_COUNTER_TYPE total_runtime = 0;
+    const UBaseType_t count = uxTaskGetSystemState(status, TaskStats::MAX_TASKS, &total_runtime);
+    if (!count) {
+        ESP_LOGW(TAG, "%u tasks, more than TASK_STATS_MAX_TASKS", static_cast<unsigned>(uxTaskGetNumberOfTasks()));
+        return false;
+    }
+    for (UBaseType_t i = 0; i < count; i++) {
+        samples[i].id = status[i].xTaskNumber;
+        samples[i].name = status[i].pcTaskName;
+        samples[i].runtime = static_cast<uint32_t>(status[i].ulRunTimeCounter);
+        samples[i].stack_free = status[i].usStackHighWaterMark;
+#if CONFIG_FREERTOS_VTASKLIST_INCLUDE_COREID
+        samples[i].core = status[i].xCoreID == tskNO_AFFINITY ? -1 : static_cast<int8_t>(status[i].xCoreID);
+#else
+        samples[i].core = -1;
+#endif
+        samples[i].priority = static_cast<uint8_t>(status[i].uxCurrentPriority);
+    }
+    taskStats.update(samples, count, static_cast<uint32_t>(total_runtime));
+    return true;
+#else
+    return false;
+#endif
+}
+
+void getTaskStats(socket_message_TaskStatsData &data) {
+    data.tasks_count = taskStats.count();
+    for (size_t i = 0; i < taskStats.count(); i++) {
+        const task_usage_t &task = taskStats.task(i);
+        auto &out = data.tasks[i];
+        strncpy(out.name, task.name, sizeof(out.name) - 1);
+        out.cpu_usage = task.cpu_percent;
+        out.stack_free = task.stack_free;
+        out.core = task.core;
+        out.priority = task.priority;
+    }
+}
+
 void getAnalytics(socket_message_AnalyticsData &analytics) {
     size_t fs_total = 0, fs_used = 0;
     esp_littlefs_info("spiffs", &fs_total, &fs_used);
@@ -223,6 +269,9 @@ void getAnalytics(socket_message_AnalyticsData &analytics) {
     analytics.fs_total = fs_total;
     analytics.fs_used = fs_used;
     analytics.uptime = esp_timer_get_time() / 1000;
+    analytics.cpu0_usage = std::lround(taskStats.coreUsage(0));
+    analytics.cpu1_usage = std::lround(taskStats.coreUsage(1));
+    analytics.cpu_usage = std::lround(taskStats.cpuUsage());
 }
 
 const char *resetReason(esp_reset_reason_t reason) {
@@ -1,37 +1,40 @@
-#include <Arduino.h>
 #include <unity.h>
-#include "esp_timer.h"
-#include "gait/state.h"
-#include "gait/bezier_state.h"
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_cpu.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <motion_states/walk_state.h>
 
 void test_gaitPlanner_calculateStep_time() {
     WalkState gaitPlanner;
-    body_state_t body_state = {
-        128, 0, 0, 0, 0, 0, {{1, -1, 0.7, 1}, {1, -1, -0.7, 1}, {-1, -1, 0.7, 1}, {-1, -1, -0.7, 1}}};
-    CommandMsg command = {0, 0, 0, 0, 0, 0, 0};
+    MotionState &state = gaitPlanner;
+    body_state_t body_state;
+    body_state.updateFeet(KinConfig::default_feet_positions);
+    CommandMsg command = {0, 0.8f, 0, 0, 0.5f, 1.0f, 0.5f};
+    state.handleCommand(command);
     const int num_steps = 1000;
 
-    uint64_t start = esp_timer_get_time() / 1000;
+    uint64_t start = esp_timer_get_time();
+    esp_cpu_cycle_count_t start_cycles = esp_cpu_get_cycle_count();
     for (int i = 0; i < num_steps; i++) {
-        gaitPlanner.step(body_state, command, 0.02f);
+        state.step(body_state, 0.02f);
     }
-    uint64_t end = esp_timer_get_time() / 1000;
+    esp_cpu_cycle_count_t cycles = esp_cpu_get_cycle_count() - start_cycles;
+    uint64_t duration = esp_timer_get_time() - start;
+    uint64_t max_duration = num_steps * 500; // Maximum 0.5 ms per step
 
-    uint64_t duration = end - start;
-    uint64_t max_duration = num_steps / 2; // Minimum 0.5 ms per step
-
-    char message[50];
-    snprintf(message, sizeof(message), "The step calculation took: %llu ms (%llu ms per iter)", duration,
+    char message[64];
+    snprintf(message, sizeof(message), "The step calculation took: %llu us (%llu us per iter)", duration,
              duration / num_steps);
-    ESP_LOGI("Test planner", message);
+    ESP_LOGI("Test planner", "%s", message);
+    ESP_LOGI("Test planner", "%lu cycles per step", (unsigned long)(cycles / num_steps));
     TEST_ASSERT_MESSAGE(duration <= max_duration, message);
 }
 
-void setup() {
-    vTaskDelay(2000 / portTICK_PERIOD_MS); // Allow time for Serial to initialize if running on an ESP32
+extern "C" void app_main(void) {
+    vTaskDelay(2000 / portTICK_PERIOD_MS); // Allow time for the serial monitor to attach
     UNITY_BEGIN();
     RUN_TEST(test_gaitPlanner_calculateStep_time);
     UNITY_END();
 }
-
-void loop() {}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+
+/*
+ * Minimal benchmark harness for the host build. Each benchmark is run in a few repeats and the fastest repeat is
+ * reported, which is the most stable figure on a noisy laptop.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace bench {
+
+struct Options {
+    long iterations = 200000;
+    int repeats = 5;
+    const char *filter = nullptr;
+};
+
+inline Options parseArgs(int argc, char **argv) {
+    Options opts;
+    for (int i = 1; i < argc; i++) {
+        if (!std::strcmp(argv[i], "--iterations") && i + 1 < argc) opts.iterations = std::atol(argv[++i]);
+        else if (!std::strcmp(argv[i], "--repeats") && i + 1 < argc) opts.repeats = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--filter") && i + 1 < argc) opts.filter = argv[++i];
+    }
+    return opts;
+}
+
+// Keeps the optimizer from discarding results that are otherwise unused.
+template <class T>
+inline void doNotOptimize(T const &value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/*
+ * Runs fn(i) for i in [0, iterations) and prints the best ns per call. fn returns nothing; results that would
+ * otherwise be dead should go through doNotOptimize.
+ */
+template <class Fn>
+double run(const Options &opts, const char *name, Fn &&fn, long iterations = 0) {
+    if (opts.filter && !std::strstr(name, opts.filter)) return 0;
+    const long n = iterations ? iterations : opts.iterations;
+    double best = 1e30;
+    for (int r = 0; r < opts.repeats; r++) {
+        const auto start = std::chrono::steady_clock::now();
+        for (long i = 0; i < n; i++) fn(i);
+        const auto end = std::chrono::steady_clock::now();
+        const double ns = std::chrono::duration<double, std::nano>(end - start).count() / n;
+        if (ns < best) best = ns;
+    }
+    printf("%-48s %10.1f ns/op\n", name, best);
+    return best;
+}
+
+} // namespace bench
@@ -0,0 +1,295 @@
+#include "bench.h"
+#include "pose_batch.h"
+
+#include <motion.h>
+#include <peripherals/servo_controller.h>
+#include <utils/attitude_filter.h>
+#include <utils/loop_timer.h>
+
+#include <vector>
+
+/*
+ * Per-tick cost of the control path. Body states are pre-recorded from a walking gait so the kinematics benchmark
+ * never hits its unchanged-state early-out.
+ */
+
+static socket_message_ControllerData walkInput(float x, float y) {
+    socket_message_ControllerData data = socket_message_ControllerData_init_zero;
+    data.has_left = true;
+    data.left = {x, y};
+    data.has_right = true;
+    data.right = {0, 0};
+    data.height = 0.5f;
+    data.speed = 1.0f;
+    data.s1 = 0.5f;
+    return data;
+}
+
+static void benchWalkState(const bench::Options &opts) {
+    WalkState walk;
+    MotionState &state = walk;
+    CommandMsg cmd;
+    cmd.fromProto(walkInput(0.2f, 0.8f));
+    state.handleCommand(cmd);
+    body_state_t body;
+    body.updateFeet(KinConfig::default_feet_positions);
+
+    bench::run(opts, "WalkState::step (trot)", [&](long) {
+        state.step(body, 0.01f);
+        bench::doNotOptimize(body);
+    });
+
+    walk.set_mode_crawl();
+    bench::run(opts, "WalkState::step (crawl)", [&](long) {
+        state.step(body, 0.01f);
+        bench::doNotOptimize(body);
+    });
+}
+
+static void benchKinematics(const bench::Options &opts) {
+    const std::vector<body_state_t> states = recordWalk(1024);
+    Kinematics<> kinematics;
+    float angles[12];
+
+    auto reportLegs = [&](double ns) {
+        const ik_stats_t &stats = kinematics.stats();
+        if (ns > 0) printf("%-48s %10.2f legs/tick\n", "", (double)stats.legs_solved / stats.calls);
+        kinematics.resetStats();
+    };
+
+    reportLegs(bench::run(opts, "Kinematics::calculate_inverse_kinematics (trot)", [&](long i) {
+        kinematics.calculate_inverse_kinematics(states[i & 1023], angles);
+        bench::doNotOptimize(angles);
+    }));
+
+    const std::vector<body_state_t> crawl = recordCrawl(1024);
+    kinematics.resetStats();
+    reportLegs(bench::run(opts, "Kinematics::calculate_inverse_kinematics (crawl)", [&](long i) {
+        kinematics.calculate_inverse_kinematics(crawl[i & 1023], angles);
+        bench::doNotOptimize(angles);
+    }));
+
+    body_state_t stand;
+    stand.updateFeet(KinConfig::default_feet_positions);
+    kinematics.resetStats();
+    reportLegs(bench::run(opts, "Kinematics::calculate_inverse_kinematics (stand)", [&](long) {
+        kinematics.calculate_inverse_kinematics(stand, angles);
+        bench::doNotOptimize(angles);
+    }));
+
+    std::vector<std::array<float, 12>> solved(states.size());
+    for (size_t i = 0; i < states.size(); i++) Kinematics<>().calculate_inverse_kinematics(states[i], solved[i].data());
+    float feet_body[4][3], feet_world[4][3];
+    bench::run(opts, "Kinematics::calculate_forward_kinematics", [&](long i) {
+        Kinematics<>::calculate_forward_kinematics(states[i & 1023], solved[i & 1023].data(), feet_body, feet_world);
+        bench::doNotOptimize(feet_world);
+    });
+    float J[3][3];
+    bench::run(opts, "Kinematics::legJacobian", [&](long i) {
+        Kinematics<>::legJacobian(i & 3, solved[(i >> 2) & 1023].data() + (i & 3) * 3, J);
+        bench::doNotOptimize(J);
+    });
+
+    // Leg-frame targets covering the stance/swing envelope, shared by both trig modes.
+    std::vector<std::array<float, 3>> targets(1024);
+    for (size_t i = 0; i < targets.size(); i++) {
+        float local[3];
+        Kinematics<>::legFK(solved[i].data(), local);
+        targets[i] = {local[0], local[1], local[2]};
+    }
+    float leg[3];
+    bench::run(opts, "Kinematics::legIK<StdTrig>", [&](long i) {
+        const auto &t = targets[i & 1023];
+        Kinematics<>::legIK<StdTrig>(t[0], t[1], t[2], leg);
+        bench::doNotOptimize(leg);
+    });
+    bench::run(opts, "Kinematics::legIK<FastTrig>", [&](long i) {
+        const auto &t = targets[i & 1023];
+        Kinematics<>::legIK<FastTrig>(t[0], t[1], t[2], leg);
+        bench::doNotOptimize(leg);
+    });
+    float rot[3][3];
+    bench::run(opts, "Kinematics::euler2R<StdTrig>", [&](long i) {
+        const body_state_t &b = states[i & 1023];
+        Kinematics<>::euler2R<StdTrig>(b.omega * DEG2RAD_F, b.phi * DEG2RAD_F, b.psi * DEG2RAD_F, rot);
+        bench::doNotOptimize(rot);
+    });
+    bench::run(opts, "Kinematics::euler2R<FastTrig>", [&](long i) {
+        const body_state_t &b = states[i & 1023];
+        Kinematics<>::euler2R<FastTrig>(b.omega * DEG2RAD_F, b.phi * DEG2RAD_F, b.psi * DEG2RAD_F, rot);
+        bench::doNotOptimize(rot);
+    });
+
+    PoseBatch batch;
+    for (const auto &body : states) batch.push(body);
+    const body_state_soa_t view = batch.view();
+    std::vector<float> batched(batch.size() * 12);
+    const double ns = bench::run(
+        opts, "Kinematics::calculate_inverse_kinematics_batch",
+        [&](long) {
+            Kinematics<>::calculate_inverse_kinematics_batch(view, batched.data());
+            bench::doNotOptimize(batched.data());
+        },
+        std::max(1L, opts.iterations / (long)batch.size()));
+    if (ns > 0) printf("%-48s %10.1f ns/pose (%.0f poses/ms)\n", "", ns / batch.size(), 1e6 * batch.size() / ns);
+}
+
+// Same solver instantiated for every robot geometry, so variants can be compared from one binary.
+template <class Variant>
+static void benchVariant(const bench::Options &opts) {
+    const std::vector<body_state_t> poses = randomPoses<Variant>(1024, 11);
+    char name[64];
+    Kinematics<Variant> kinematics;
+    float angles[12];
+    snprintf(name, sizeof(name), "Kinematics<%s> IK (random)", Variant::name);
+    bench::run(opts, name, [&](long i) {
+        kinematics.calculate_inverse_kinematics(poses[i & 1023], angles);
+        bench::doNotOptimize(angles);
+    });
+
+    PoseBatch batch;
+    for (const auto &body : poses) batch.push(body);
+    const body_state_soa_t view = batch.view();
+    std::vector<float> batched(batch.size() * 12);
+    snprintf(name, sizeof(name), "Kinematics<%s> batch", Variant::name);
+    const double ns = bench::run(
+        opts, name,
+        [&](long) {
+            Kinematics<Variant>::calculate_inverse_kinematics_batch(view, batched.data());
+            bench::doNotOptimize(batched.data());
+        },
+        std::max(1L, opts.iterations / (long)batch.size()));
+    if (ns > 0) printf("%-48s %10.1f ns/pose\n", "", ns / batch.size());
+}
+
+static void benchMotionService(const bench::Options &opts) {
+    host_clock::useManualClock(true);
+    Peripherals peripherals;
+    MotionService motion;
+    motion.begin();
+
+    socket_message_ModeData mode = {socket_message_ModesEnum_STAND};
+    motion.handleMode(mode);
+    bench::run(opts, "MotionService::update (stand)", [&](long) {
+        host_clock::advance(10000);
+        bench::doNotOptimize(motion.update(&peripherals));
+    });
+
+    mode.mode = socket_message_ModesEnum_WALK;
+    motion.handleMode(mode);
+    motion.handleInput(walkInput(0.2f, 0.8f));
+    bench::run(opts, "MotionService::update (walk)", [&](long) {
+        host_clock::advance(10000);
+        bench::doNotOptimize(motion.update(&peripherals));
+    });
+    host_clock::useManualClock(false);
+}
+
+static void benchServoController(const bench::Options &opts) {
+    I2CBus::instance().begin(GPIO_NUM_NC, GPIO_NUM_NC);
+    const std::vector<body_state_t> states = recordWalk(1024);
+    std::vector<std::array<float, 12>> angles(states.size());
+    Kinematics<> kinematics;
+    for (size_t i = 0; i < states.size(); i++) kinematics.calculate_inverse_kinematics(states[i], angles[i].data());
+
+    ServoController servos;
+    servos.begin();
+    servos.activate();
+
+    host_i2c::resetStats();
+    const double ns = bench::run(opts, "ServoController::calculatePWM", [&](long i) {
+        servos.setAngles(angles[i & 1023].data());
+        servos.calculatePWM();
+    });
+    const auto &stats = host_i2c::stats();
+    const double ticks = static_cast<double>(opts.iterations) * opts.repeats;
+    if (ns > 0 && stats.transactions)
+        printf("%-48s %10.2f transactions, %.1f bytes per tick\n", "  i2c traffic", stats.transactions / ticks,
+               stats.bytes_written / ticks);
+    I2CBus::instance().end();
+}
+
+// The angle to tick stage alone, without the bus writes that dominate calculatePWM on the host.
+static void benchServoTable(const bench::Options &opts) {
+    const std::vector<body_state_t> states = recordWalk(1024);
+    std::vector<std::array<servo_angle_t, 12>> targets(states.size());
+    Kinematics<> kinematics;
+    for (size_t i = 0; i < states.size(); i++) {
+        float angles[12];
+        kinematics.calculate_inverse_kinematics(states[i], angles);
+        for (int j = 0; j < 12; j++) targets[i][j] = servo_angle_t(angles[j]);
+    }
+
+    ServoPWMTable table;
+    table.rebuild(ServoSettings_defaults());
+    uint16_t pwms[12];
+    bench::run(opts, "ServoPWMTable::step", [&](long i) {
+        table.step(targets[i & 1023].data(), pwms);
+        bench::doNotOptimize(pwms);
+    });
+}
+
+/*
+ * The control task's work per tick (motion, servo angles, PWM frame) woken by a LoopTimer on the manual clock, at
+ * the rates the loop supports. The share of the period it uses is host time against the MCU period, so it is only
+ * comparable between rates and builds, not a prediction of the target's load.
+ */
+static void benchControlLoop(const bench::Options &opts) {
+    host_clock::useManualClock(true);
+    I2CBus::instance().begin(GPIO_NUM_NC, GPIO_NUM_NC);
+    Peripherals peripherals;
+    ServoController servos;
+    servos.begin();
+    servos.activate();
+    for (uint32_t hz : {100u, 250u, 500u}) {
+        MotionService motion;
+        motion.begin();
+        socket_message_ModeData mode = {socket_message_ModesEnum_WALK};
+        motion.handleMode(mode);
+        motion.handleInput(walkInput(0.2f, 0.8f));
+        LoopTimer timer;
+        timer.start(hz);
+        char name[64];
+        snprintf(name, sizeof(name), "control tick @ %u Hz (walk)", static_cast<unsigned>(hz));
+        const double ns = bench::run(opts, name, [&](long) {
+            motion.update(&peripherals, timer.wait());
+            servos.setAngles(motion.getAngles());
+            servos.calculatePWM();
+        });
+        if (ns > 0) printf("%-48s %10.3f%% of the %u us period\n", "", ns / 10.0 / timer.periodUs(), timer.periodUs());
+    }
+    I2CBus::instance().end();
+    host_clock::useManualClock(false);
+}
+
+// One raw IMU sample through the attitude filter; the sensor task runs this 1000 times a second in RAW mode.
+template <typename Filter>
+static void benchAttitudeFilter(const bench::Options &opts, const char *name) {
+    using S = typename Filter::Scalar;
+    Filter filter;
+    const S gyro_scale(DEG2RAD_F / 65.5f), accel_scale(1.0f / 16384.0f), dt(0.001f);
+    bench::run(opts, name, [&](long i) {
+        const int16_t wobble = static_cast<int16_t>((i & 63) - 32);
+        filter.update(gyro_scale * (wobble * 4), gyro_scale * -wobble, gyro_scale * 3, accel_scale * (wobble * 8),
+                      accel_scale * 120, accel_scale * 16300, dt);
+        bench::doNotOptimize(filter);
+    });
+}
+
+int main(int argc, char **argv) {
+    const bench::Options opts = bench::parseArgs(argc, argv);
+    printf("Motion stack benchmark (%s%s, %ld iterations, best of %d)\n", KINEMATICS_VARIANT_NAME,
+           KINEMATICS_FAST_MATH ? ", fast math" : "", opts.iterations, opts.repeats);
+    benchWalkState(opts);
+    benchKinematics(opts);
+    benchVariant<SpotMicroESP32>(opts);
+    benchVariant<SpotMicroESP32Mini>(opts);
+    benchVariant<SpotMicroYertle>(opts);
+    benchMotionService(opts);
+    benchServoController(opts);
+    benchServoTable(opts);
+    benchControlLoop(opts);
+    benchAttitudeFilter<MadgwickFloat>(opts, "Madgwick<float>::update");
+    benchAttitudeFilter<MadgwickFixed>(opts, "Madgwick<Fixed<24>>::update");
+    return 0;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+/*
+ * Replays a command log (utils/command_log.h) through MotionService and its kinematics, on the manual clock so it
+ * runs as fast as the host allows and the same log always produces the same joint angles. The control loop is a
+ * LoopTimer at the given rate, as on the robot; each record is delivered just before the first tick at or after its
+ * timestamp, which is the tick that would have picked it up live.
+ */
+
+#include <motion.h>
+#include <utils/command_log.h>
+#include <utils/loop_timer.h>
+
+#include <chrono>
+#include <cstdint>
+
+struct replay_tick_t {
+    int64_t time_us;
+    const float *angles; // the 12 joint angles after the tick
+    uint32_t tick_ns;    // host time spent in MotionService::update
+};
+
+inline void applyRecord(const command_log::record_t &record, MotionService &motion, Peripherals &peripherals) {
+    using command_log::Type;
+    switch (record.type) {
+        case Type::CONTROLLER: {
+            socket_message_ControllerData data = socket_message_ControllerData_init_zero;
+            data.has_left = data.has_right = true;
+            data.left = {record.input.lx, record.input.ly};
+            data.right = {record.input.rx, record.input.ry};
+            data.height = record.input.h;
+            data.speed = record.input.s;
+            data.s1 = record.input.s1;
+            motion.handleInput(data);
+            break;
+        }
+        case Type::LINK_LOST: motion.onControlLinkLost(); break;
+        case Type::MODE: {
+            socket_message_ModeData data = {static_cast<socket_message_ModesEnum>(record.mode)};
+            motion.handleMode(data);
+            break;
+        }
+        case Type::WALK_GAIT: {
+            socket_message_WalkGaitData data = {static_cast<socket_message_WalkGaits>(record.gait)};
+            motion.handleWalkGait(data);
+            break;
+        }
+        case Type::ANGLES: {
+            socket_message_AnglesData data = {};
+            data.angles_count = record.angle_count;
+            std::copy(record.angles, record.angles + record.angle_count, data.angles);
+            motion.handleAngles(data);
+            break;
+        }
+        case Type::GESTURE: peripherals.setGesture(static_cast<gesture_t>(record.gesture)); break;
+    }
+}
+
+/*
+ * Runs the log to its end plus tail_s seconds for the robot to settle, calling on_tick(const replay_tick_t &) after
+ * every tick. Returns the number of ticks.
+ */
+template <typename OnTick>
+uint64_t replayCommands(command_log::Reader &reader, uint32_t rate_hz, float tail_s, OnTick &&on_tick) {
+    host_clock::useManualClock(true);
+    host_clock::setTime(0);
+    Peripherals peripherals;
+    MotionService motion;
+    motion.begin();
+    LoopTimer timer;
+    timer.start(rate_hz);
+
+    command_log::record_t record;
+    bool pending = reader.next(record);
+    int64_t end_us = pending ? INT64_MAX : static_cast<int64_t>(tail_s * 1e6f);
+    uint64_t ticks = 0;
+    while (esp_timer_get_time() < end_us) {
+        const float dt = timer.wait();
+        const int64_t now = esp_timer_get_time();
+        for (; pending && record.time_us <= now; pending = reader.next(record)) {
+            applyRecord(record, motion, peripherals);
+        }
+        if (!pending && end_us == INT64_MAX) end_us = now + static_cast<int64_t>(tail_s * 1e6f);
+
+        const auto start = std::chrono::steady_clock::now();
+        motion.update(&peripherals, dt);
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        on_tick(replay_tick_t {now, motion.getAngles(),
+                               static_cast<uint32_t>(std::chrono::nanoseconds(elapsed).count())});
+        ticks++;
+    }
+    host_clock::useManualClock(false);
+    return ticks;
+}
@@ -0,0 +1,64 @@
+/*
+ * Converts a flight recorder dump (utils/flight_recorder.h) to CSV, one row per control tick.
+ *
+ *   flight_decode <flight_NNN.bin> [out.csv]
+ *
+ * Time is in microseconds from the first record, unwrapped from the recorder's 32-bit stamps; the `trigger` column
+ * marks the tick that froze the recorder. Joint and IMU angles are in degrees; the body pose and feet are in the
+ * units of body_state_t.
+ */
+#include <utils/flight_recorder.h>
+
+#include <cstdio>
+#include <cstring>
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <flight.bin> [out.csv]\n", argv[0]);
+        return 2;
+    }
+    FILE *in = fopen(argv[1], "rb");
+    flight_recorder::file_header_t header;
+    if (!in || fread(&header, sizeof(header), 1, in) != 1 ||
+        std::memcmp(header.magic, flight_recorder::MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != flight_recorder::VERSION || header.record_size != sizeof(flight_recorder::record_t)) {
+        fprintf(stderr, "%s is not a flight recorder dump this decoder understands\n", argv[1]);
+        return 1;
+    }
+    FILE *out = argc > 2 ? fopen(argv[2], "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "cannot write %s\n", argv[2]);
+        return 1;
+    }
+
+    fprintf(out, "time_us,dt_us,busy_us,missed,mode,trigger,omega,phi,psi,xm,ym,zm");
+    for (int leg = 0; leg < 4; leg++) fprintf(out, ",foot%d_x,foot%d_y,foot%d_z", leg, leg, leg);
+    for (int i = 0; i < 12; i++) fprintf(out, ",target%d", i);
+    for (int i = 0; i < 12; i++) fprintf(out, ",angle%d", i);
+    fprintf(out, ",imu_x,imu_y,imu_z\n");
+
+    flight_recorder::record_t record;
+    uint32_t last_us = 0;
+    int64_t elapsed_us = 0;
+    uint32_t index = 0;
+    for (; index < header.count && fread(&record, sizeof(record), 1, in) == 1; index++) {
+        if (index == 0) last_us = record.time_us;
+        // Unsigned difference, so the 71 minute wrap of the stamps does not show.
+        elapsed_us += static_cast<uint32_t>(record.time_us - last_us);
+        last_us = record.time_us;
+        fprintf(out, "%lld,%u,%u,%u,%u,%d", static_cast<long long>(elapsed_us), record.dt_us, record.busy_us,
+                record.missed, record.mode, index == header.trigger_index ? header.trigger : 0);
+        for (float value : record.body) fprintf(out, ",%.5g", value);
+        for (const auto &foot : record.feet) fprintf(out, ",%.5g,%.5g,%.5g", foot[0], foot[1], foot[2]);
+        for (int16_t angle : record.target) fprintf(out, ",%.2f", angle / 100.0f);
+        for (int16_t angle : record.angles) fprintf(out, ",%.2f", angle / 100.0f);
+        for (int16_t angle : record.imu) fprintf(out, ",%.2f", angle / 100.0f);
+        fprintf(out, "\n");
+    }
+    fclose(in);
+    if (out != stdout) fclose(out);
+    fprintf(stderr, "%u records over %.3f s, triggered by %s at record %u\n", index, elapsed_us / 1e6,
+            flight_recorder::Recorder::triggerName(static_cast<flight_recorder::Trigger>(header.trigger)),
+            header.trigger_index);
+    return index == header.count ? 0 : 1;
+}
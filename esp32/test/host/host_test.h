@@ -0,0 +1,37 @@
+#pragma once
+
+/*
+ * Tiny assertion helpers for the host tests. Keeps the host build dependency-free; each test binary returns the
+ * number of failed checks so ctest picks up failures.
+ */
+
+#include <cmath>
+#include <cstdio>
+
+namespace host_test {
+
+inline int failures = 0;
+
+inline void check(bool ok, const char *expr, const char *file, int line) {
+    if (ok) return;
+    failures++;
+    fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expr);
+}
+
+inline void checkNear(double a, double b, double tol, const char *expr, const char *file, int line) {
+    if (std::fabs(a - b) <= tol) return;
+    failures++;
+    fprintf(stderr, "%s:%d: check failed: %s (%f vs %f, tol %f)\n", file, line, expr, a, b, tol);
+}
+
+} // namespace host_test
+
+#define CHECK(expr) host_test::check((expr), #expr, __FILE__, __LINE__)
+#define CHECK_NEAR(a, b, tol) host_test::checkNear((a), (b), (tol), #a " ~= " #b, __FILE__, __LINE__)
+
+#define RUN_TEST(fn)                        \
+    do {                                    \
+        const int before = host_test::failures; \
+        fn();                               \
+        printf("%s %s\n", host_test::failures == before ? "[ OK ]" : "[FAIL]", #fn); \
+    } while (0)
@@ -0,0 +1,88 @@
+#pragma once
+
+/*
+ * Owning SoA storage for batched IK in tests and benchmarks, plus generators for representative pose sets.
+ */
+
+#include <kinematics.h>
+#include <motion_states/walk_state.h>
+
+#include <random>
+#include <vector>
+
+struct PoseBatch {
+    std::vector<float> omega, phi, psi, xm, ym, zm;
+    std::vector<float> feet[4][3];
+
+    void push(const body_state_t &body) {
+        omega.push_back(body.omega);
+        phi.push_back(body.phi);
+        psi.push_back(body.psi);
+        xm.push_back(body.xm);
+        ym.push_back(body.ym);
+        zm.push_back(body.zm);
+        for (int leg = 0; leg < 4; leg++)
+            for (int axis = 0; axis < 3; axis++) feet[leg][axis].push_back(body.feet[leg][axis]);
+    }
+
+    size_t size() const { return omega.size(); }
+
+    body_state_soa_t view() const {
+        body_state_soa_t soa;
+        soa.count = size();
+        soa.omega = omega.data();
+        soa.phi = phi.data();
+        soa.psi = psi.data();
+        soa.xm = xm.data();
+        soa.ym = ym.data();
+        soa.zm = zm.data();
+        for (int leg = 0; leg < 4; leg++)
+            for (int axis = 0; axis < 3; axis++) soa.feet[leg][axis] = feet[leg][axis].data();
+        return soa;
+    }
+};
+
+// Body states produced by walking with a constant command, one per 10 ms tick.
+inline std::vector<body_state_t> recordWalk(size_t ticks, float lx = 0.2f, float ly = 0.8f, bool crawl = false) {
+    WalkState walk;
+    if (crawl) walk.set_mode_crawl();
+    MotionState &state = walk;
+    CommandMsg cmd = {lx, ly, 0, 0, 0.5f, 1.0f, 0.5f};
+    state.begin();
+    state.handleCommand(cmd);
+
+    body_state_t body;
+    body.updateFeet(KinConfig::default_feet_positions);
+    std::vector<body_state_t> states(ticks);
+    for (size_t i = 0; i < ticks; i++) {
+        state.step(body, 0.01f);
+        states[i] = body;
+    }
+    return states;
+}
+
+inline std::vector<body_state_t> recordCrawl(size_t ticks) { return recordWalk(ticks, 0.0f, 0.5f, true); }
+
+// Random body poses within the controller limits of `Variant`, feet jittered around its default stance.
+template <class Variant = KinVariant>
+inline std::vector<body_state_t> randomPoses(size_t count, unsigned seed = 1) {
+    using Config = KinematicsConfig<Variant>;
+    std::mt19937 rng(seed);
+    auto uniform = [&](float lo, float hi) { return std::uniform_real_distribution<float>(lo, hi)(rng); };
+    std::vector<body_state_t> states(count);
+    for (auto &body : states) {
+        body.omega = uniform(-Config::max_roll, Config::max_roll);
+        body.phi = uniform(-Config::max_roll, Config::max_roll);
+        body.psi = uniform(-Config::max_pitch, Config::max_pitch);
+        body.xm = uniform(-Config::max_body_shift_x, Config::max_body_shift_x);
+        body.ym = uniform(Config::min_body_height, Config::max_body_height);
+        body.zm = uniform(-Config::max_body_shift_z, Config::max_body_shift_z);
+        body.updateFeet(Config::default_feet_positions);
+        for (int leg = 0; leg < 4; leg++) {
+            body.feet[leg][0] += uniform(-0.3f, 0.3f) * Config::max_step_length;
+            body.feet[leg][1] += uniform(0.0f, 0.5f) * Config::max_step_height;
+            body.feet[leg][2] += uniform(-0.1f, 0.1f) * Config::max_step_length;
+        }
+    }
+    return states;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <esp_err.h>
+
+/*
+ * GPIO stand-in: configuration calls succeed and do nothing, inputs read low. Lets the sensor drivers compile so
+ * their pure logic can be tested; no interrupt ever fires on the host.
+ */
+
+typedef enum { GPIO_NUM_NC = -1 } gpio_num_t;
+
+typedef enum { GPIO_MODE_DISABLE = 0, GPIO_MODE_INPUT = 1, GPIO_MODE_OUTPUT = 2 } gpio_mode_t;
+
+typedef enum {
+    GPIO_INTR_DISABLE = 0,
+    GPIO_INTR_POSEDGE = 1,
+    GPIO_INTR_NEGEDGE = 2,
+    GPIO_INTR_ANYEDGE = 3,
+} gpio_int_type_t;
+
+typedef enum {
+    GPIO_PULLUP_ONLY = 0,
+    GPIO_PULLDOWN_ONLY = 1,
+    GPIO_PULLUP_PULLDOWN = 2,
+    GPIO_FLOATING = 3,
+} gpio_pull_mode_t;
+
+typedef void (*gpio_isr_t)(void *arg);
+
+inline esp_err_t gpio_install_isr_service(int) { return ESP_OK; }
+inline esp_err_t gpio_isr_handler_add(gpio_num_t, gpio_isr_t, void *) { return ESP_OK; }
+inline esp_err_t gpio_isr_handler_remove(gpio_num_t) { return ESP_OK; }
+inline esp_err_t gpio_reset_pin(gpio_num_t) { return ESP_OK; }
+inline esp_err_t gpio_set_direction(gpio_num_t, gpio_mode_t) { return ESP_OK; }
+inline esp_err_t gpio_set_pull_mode(gpio_num_t, gpio_pull_mode_t) { return ESP_OK; }
+inline esp_err_t gpio_set_intr_type(gpio_num_t, gpio_int_type_t) { return ESP_OK; }
+inline esp_err_t gpio_intr_enable(gpio_num_t) { return ESP_OK; }
+inline esp_err_t gpio_intr_disable(gpio_num_t) { return ESP_OK; }
+inline esp_err_t gpio_set_level(gpio_num_t, uint32_t) { return ESP_OK; }
+inline int gpio_get_level(gpio_num_t) { return 0; }
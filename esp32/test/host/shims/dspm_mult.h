@@ -0,0 +1,14 @@
+#pragma once
+
+#include <esp_err.h>
+
+inline esp_err_t dspm_mult_f32_ae32(const float *A, const float *B, float *C, int m, int n, int k) {
+    for (int i = 0; i < m; i++) {
+        for (int j = 0; j < k; j++) {
+            float sum = 0;
+            for (int s = 0; s < n; s++) sum += A[i * n + s] * B[s * k + j];
+            C[i * k + j] = sum;
+        }
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdint>
+#include <esp_rom_sys.h>
+#include <esp_timer.h>
+
+typedef uint32_t esp_cpu_cycle_count_t;
+
+// The host is one core whose cycle counter follows esp_timer, so the manual clock drives it too.
+inline int esp_cpu_get_core_id() { return 0; }
+
+inline esp_cpu_cycle_count_t esp_cpu_get_cycle_count() {
+    return static_cast<esp_cpu_cycle_count_t>(esp_timer_get_time() * esp_rom_get_cpu_ticks_per_us());
+}
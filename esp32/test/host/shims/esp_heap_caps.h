@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_SPIRAM (1 << 10)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+
+// The host has no PSRAM; every allocation comes from the ordinary heap.
+inline void *heap_caps_malloc(size_t size, uint32_t) { return std::malloc(size); }
+
+inline void *heap_caps_calloc(size_t n, size_t size, uint32_t) { return std::calloc(n, size); }
+
+inline void heap_caps_free(void *ptr) { std::free(ptr); }
+
+inline size_t heap_caps_get_total_size(uint32_t caps) { return caps & MALLOC_CAP_SPIRAM ? 0 : SIZE_MAX; }
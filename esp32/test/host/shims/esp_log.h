@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdio>
+#include <esp_err.h>
+
+/*
+ * Host stand-in for the IDF logger. Errors and warnings go to stderr so failures stay visible in test output,
+ * everything else is compiled out to keep benchmark loops free of I/O.
+ */
+#define ESP_LOGE(tag, format, ...) fprintf(stderr, "E (%s) " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) fprintf(stderr, "W (%s) " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) ((void)(tag))
+#define ESP_LOGD(tag, format, ...) ((void)(tag))
+#define ESP_LOGV(tag, format, ...) ((void)(tag))
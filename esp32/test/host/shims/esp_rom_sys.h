@@ -0,0 +1,5 @@
+#pragma once
+
+#include <cstdint>
+
+inline uint32_t esp_rom_get_cpu_ticks_per_us() { return 240; }
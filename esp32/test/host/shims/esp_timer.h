@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <esp_err.h>
+
+/*
+ * Host stand-in for esp_timer. By default time follows the host monotonic clock; tests and replay tools can switch
+ * to a manual clock so dt fed through the motion stack is deterministic.
+ */
+int64_t esp_timer_get_time();
+
+/*
+ * Periodic timers do not run on their own: a task waiting on a notification (ulTaskNotifyTake) moves to the next
+ * deadline, jumping the manual clock or sleeping on the host clock, and the callbacks run there in the waiting
+ * thread. A timer that fell behind fires once per elapsed period, as on the target.
+ */
+typedef struct esp_timer *esp_timer_handle_t;
+typedef void (*esp_timer_cb_t)(void *arg);
+
+typedef enum { ESP_TIMER_TASK, ESP_TIMER_ISR } esp_timer_dispatch_t;
+
+typedef struct {
+    esp_timer_cb_t callback;
+    void *arg;
+    esp_timer_dispatch_t dispatch_method;
+    const char *name;
+    bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out_handle);
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us);
+
+esp_err_t esp_timer_restart(esp_timer_handle_t timer, uint64_t timeout_us);
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer);
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer);
+
+namespace host_clock {
+
+void useManualClock(bool manual);
+
+void setTime(int64_t us);
+
+void advance(int64_t us);
+
+} // namespace host_clock
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+#include <sdkconfig.h>
+#include <esp_attr.h>
+#include <esp_err.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+
+#define portMAX_DELAY (TickType_t)0xffffffffUL
+#define portTICK_PERIOD_MS ((TickType_t)1000 / CONFIG_FREERTOS_HZ)
+#define pdMS_TO_TICKS(xTimeInMs) ((TickType_t)(((uint64_t)(xTimeInMs) * CONFIG_FREERTOS_HZ) / 1000U))
+#define tskNO_AFFINITY 0x7FFFFFFF
+#define portNUM_PROCESSORS CONFIG_FREERTOS_NUMBER_OF_CORES
+#define configMAX_TASK_NAME_LEN 16
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <freertos/FreeRTOS.h>
+
+typedef void *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+/*
+ * Tick count is derived from esp_timer_get_time() so the host and manual clocks stay in step. Delays advance the
+ * manual clock when it is active and are no-ops otherwise; the host build never blocks.
+ */
+TickType_t xTaskGetTickCount();
+
+void vTaskDelay(TickType_t ticks);
+
+void vTaskDelayUntil(TickType_t *previousWakeTime, TickType_t timeIncrement);
+
+inline BaseType_t xPortGetCoreID() { return 0; }
+
+// Tasks are never started on the host; tests drive the work loops directly.
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t, const char *, uint32_t, void *, UBaseType_t,
+                                          TaskHandle_t *created, BaseType_t) {
+    if (created) *created = nullptr;
+    return pdFAIL;
+}
+
+// The host runs everything on the calling thread, which is "the" task for notifications.
+inline TaskHandle_t xTaskGetCurrentTaskHandle() { return nullptr; }
+
+inline char *pcTaskGetName(TaskHandle_t) {
+    static char name[] = "main";
+    return name;
+}
+
+/*
+ * Notifications share one count. Taking with nothing given runs any esp_timer due within ticksToWait (see
+ * esp_timer.h); with no timer armed it returns 0 immediately, so nothing on the host blocks forever.
+ */
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait);
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higherPriorityTaskWoken);
+
+#define portYIELD_FROM_ISR(...)
@@ -0,0 +1,276 @@
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <driver/i2c_master.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Clock
+ */
+static bool manual_clock = false;
+static int64_t manual_time_us = 0;
+
+int64_t esp_timer_get_time() {
+    if (manual_clock) return manual_time_us;
+    static const auto boot = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - boot).count();
+}
+
+namespace host_clock {
+
+void useManualClock(bool manual) { manual_clock = manual; }
+
+void setTime(int64_t us) { manual_time_us = us; }
+
+void advance(int64_t us) { manual_time_us += us; }
+
+} // namespace host_clock
+
+/*
+ * Tasks
+ */
+static constexpr int64_t US_PER_TICK = 1000000 / CONFIG_FREERTOS_HZ;
+
+TickType_t xTaskGetTickCount() { return static_cast<TickType_t>(esp_timer_get_time() / US_PER_TICK); }
+
+void vTaskDelay(TickType_t ticks) {
+    if (manual_clock) manual_time_us += static_cast<int64_t>(ticks) * US_PER_TICK;
+}
+
+void vTaskDelayUntil(TickType_t *previousWakeTime, TickType_t timeIncrement) {
+    *previousWakeTime += timeIncrement;
+    if (manual_clock) {
+        const int64_t wake_us = static_cast<int64_t>(*previousWakeTime) * US_PER_TICK;
+        if (wake_us > manual_time_us) manual_time_us = wake_us;
+    }
+}
+
+/*
+ * Timers and notifications
+ */
+struct esp_timer {
+    esp_timer_cb_t callback;
+    void *arg;
+    int64_t period_us {0};
+    int64_t deadline_us {0};
+    bool armed {false};
+};
+
+static std::vector<esp_timer *> timers;
+static uint32_t notifications = 0;
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out_handle) {
+    if (!args || !args->callback || !out_handle) return ESP_ERR_INVALID_ARG;
+    *out_handle = new esp_timer {args->callback, args->arg};
+    timers.push_back(*out_handle);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us) {
+    if (!timer || !period_us) return ESP_ERR_INVALID_ARG;
+    if (timer->armed) return ESP_ERR_INVALID_STATE;
+    timer->period_us = static_cast<int64_t>(period_us);
+    timer->deadline_us = esp_timer_get_time() + timer->period_us;
+    timer->armed = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_restart(esp_timer_handle_t timer, uint64_t timeout_us) {
+    if (!timer || !timeout_us) return ESP_ERR_INVALID_ARG;
+    if (!timer->armed) return ESP_ERR_INVALID_STATE;
+    timer->period_us = static_cast<int64_t>(timeout_us);
+    timer->deadline_us = esp_timer_get_time() + timer->period_us;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    if (!timer) return ESP_ERR_INVALID_ARG;
+    if (!timer->armed) return ESP_ERR_INVALID_STATE;
+    timer->armed = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+    if (!timer) return ESP_ERR_INVALID_ARG;
+    if (timer->armed) return ESP_ERR_INVALID_STATE;
+    timers.erase(std::remove(timers.begin(), timers.end(), timer), timers.end());
+    delete timer;
+    return ESP_OK;
+}
+
+static void runDueTimers(int64_t now) {
+    for (esp_timer *timer : timers) {
+        while (timer->armed && timer->deadline_us <= now) {
+            timer->deadline_us += timer->period_us;
+            timer->callback(timer->arg);
+        }
+    }
+}
+
+static void waitUntil(int64_t us) {
+    if (manual_clock) {
+        manual_time_us = std::max(manual_time_us, us);
+    } else {
+        std::this_thread::sleep_for(std::chrono::microseconds(us - esp_timer_get_time()));
+    }
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait) {
+    runDueTimers(esp_timer_get_time());
+    if (!notifications) {
+        int64_t deadline = INT64_MAX;
+        for (const esp_timer *timer : timers) {
+            if (timer->armed) deadline = std::min(deadline, timer->deadline_us);
+        }
+        if (deadline == INT64_MAX) return 0;
+        if (ticksToWait != portMAX_DELAY) {
+            deadline = std::min(deadline, esp_timer_get_time() + static_cast<int64_t>(ticksToWait) * US_PER_TICK);
+        }
+        waitUntil(deadline);
+        runDueTimers(esp_timer_get_time());
+    }
+    const uint32_t count = notifications;
+    notifications = clearCountOnExit ? 0 : count - (count > 0);
+    return count;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t) {
+    notifications++;
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t, BaseType_t *) { notifications++; }
+
+/*
+ * Semaphores
+ */
+struct HostSemaphore {
+    std::recursive_timed_mutex mutex;
+};
+
+SemaphoreHandle_t xSemaphoreCreateMutex() { return new HostSemaphore(); }
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex() { return new HostSemaphore(); }
+
+void vSemaphoreDelete(SemaphoreHandle_t sem) { delete sem; }
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks) {
+    if (ticks == portMAX_DELAY) {
+        sem->mutex.lock();
+        return pdTRUE;
+    }
+    return sem->mutex.try_lock_for(std::chrono::milliseconds(ticks * portTICK_PERIOD_MS)) ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+    sem->mutex.unlock();
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t sem, TickType_t ticks) { return xSemaphoreTake(sem, ticks); }
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t sem) { return xSemaphoreGive(sem); }
+
+/*
+ * I2C
+ */
+struct host_i2c_bus {
+    uint32_t devices = 0;
+};
+
+struct host_i2c_dev {
+    host_i2c_bus *bus;
+    uint16_t address;
+};
+
+static host_i2c::Stats i2c_stats {};
+static uint8_t i2c_registers[128][256] {};
+
+static void storeWrite(uint16_t addr, const uint8_t *data, size_t size) {
+    if (!data || !size || addr >= 128) return;
+    for (size_t i = 1; i < size; i++) i2c_registers[addr][(data[0] + i - 1) & 0xFF] = data[i];
+}
+
+esp_err_t i2c_new_master_bus(const i2c_master_bus_config_t *config, i2c_master_bus_handle_t *ret_bus) {
+    if (!config || !ret_bus) return ESP_ERR_INVALID_ARG;
+    *ret_bus = new host_i2c_bus();
+    return ESP_OK;
+}
+
+esp_err_t i2c_del_master_bus(i2c_master_bus_handle_t bus) {
+    if (!bus) return ESP_ERR_INVALID_ARG;
+    if (bus->devices) return ESP_ERR_INVALID_STATE;
+    delete bus;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_add_device(i2c_master_bus_handle_t bus, const i2c_device_config_t *config,
+                                    i2c_master_dev_handle_t *ret_handle) {
+    if (!bus || !config || !ret_handle) return ESP_ERR_INVALID_ARG;
+    *ret_handle = new host_i2c_dev {bus, config->device_address};
+    bus->devices++;
+    i2c_stats.devices_added++;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_rm_device(i2c_master_dev_handle_t handle) {
+    if (!handle) return ESP_ERR_INVALID_ARG;
+    handle->bus->devices--;
+    delete handle;
+    i2c_stats.devices_removed++;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_transmit(i2c_master_dev_handle_t dev, const uint8_t *write_buffer, size_t write_size,
+                              int) {
+    if (!dev) return ESP_ERR_INVALID_ARG;
+    i2c_stats.transactions++;
+    i2c_stats.bytes_written += write_size;
+    storeWrite(dev->address, write_buffer, write_size);
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_transmit_receive(i2c_master_dev_handle_t dev, const uint8_t *write_buffer, size_t write_size,
+                                      uint8_t *read_buffer, size_t read_size, int) {
+    if (!dev) return ESP_ERR_INVALID_ARG;
+    i2c_stats.transactions++;
+    i2c_stats.bytes_written += write_size;
+    i2c_stats.bytes_read += read_size;
+    const uint8_t reg = write_size ? write_buffer[0] : 0;
+    for (size_t i = 0; i < read_size; i++) read_buffer[i] = i2c_registers[dev->address & 0x7F][(reg + i) & 0xFF];
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_receive(i2c_master_dev_handle_t dev, uint8_t *read_buffer, size_t read_size, int) {
+    if (!dev) return ESP_ERR_INVALID_ARG;
+    i2c_stats.transactions++;
+    i2c_stats.bytes_read += read_size;
+    std::memset(read_buffer, 0, read_size);
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_probe(i2c_master_bus_handle_t bus, uint16_t, int) {
+    if (!bus) return ESP_ERR_INVALID_ARG;
+    return ESP_OK;
+}
+
+namespace host_i2c {
+
+const Stats &stats() { return i2c_stats; }
+
+void resetStats() { i2c_stats = {}; }
+
+const uint8_t *registers(uint16_t addr) { return i2c_registers[addr & 0x7F]; }
+
+void setRegisters(uint16_t addr, uint8_t reg, const uint8_t *data, size_t size) {
+    for (size_t i = 0; i < size; i++) i2c_registers[addr & 0x7F][(reg + i) & 0xFF] = data[i];
+}
+
+} // namespace host_i2c
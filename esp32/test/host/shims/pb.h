@@ -0,0 +1,7 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+typedef uint_least16_t pb_size_t;
+typedef struct pb_msgdesc_s pb_msgdesc_t;
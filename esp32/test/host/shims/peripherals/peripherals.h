@@ -0,0 +1,39 @@
+#pragma once
+
+/*
+ * Host stand-in for Peripherals. The motion stack only reads IMU angles and gestures from it, so those are plain
+ * values that tests and replay tools can set directly.
+ */
+
+#include <peripherals/gesture.h>
+
+class Peripherals {
+  public:
+    void begin() {}
+
+    void update() {}
+
+    float angleX() { return _angles[0]; }
+
+    float angleY() { return _angles[1]; }
+
+    float angleZ() { return _angles[2]; }
+
+    gesture_t takeGesture() {
+        gesture_t gesture = _gesture;
+        _gesture = eGestureNone;
+        return gesture;
+    }
+
+    void setAngles(float x, float y, float z) {
+        _angles[0] = x;
+        _angles[1] = y;
+        _angles[2] = z;
+    }
+
+    void setGesture(gesture_t gesture) { _gesture = gesture; }
+
+  private:
+    float _angles[3] {0, 0, 0};
+    gesture_t _gesture {eGestureNone};
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+/*
+ * Hand-maintained mirror of the nanopb structs from platform_shared/api.proto used by the servo output stage.
+ */
+
+#include <pb.h>
+
+typedef struct _api_ServoCalibrationPoint {
+    float angle;
+    float pwm;
+} api_ServoCalibrationPoint;
+
+typedef struct _api_Servo {
+    float center_pwm;
+    float direction;
+    float center_angle;
+    float conversion;
+    char name[16];
+    pb_size_t points_count;
+    api_ServoCalibrationPoint points[8];
+} api_Servo;
+
+typedef struct _api_ServoSettings {
+    pb_size_t servos_count;
+    api_Servo servos[12];
+} api_ServoSettings;
+
+#define api_ServoSettings_fields ((const pb_msgdesc_t *)nullptr)
+#define api_ServoSettings_size 1536
@@ -0,0 +1,54 @@
+#pragma once
+
+/*
+ * Hand-maintained mirror of the nanopb structs from platform_shared/message.proto that the motion stack consumes.
+ * Only the fields the host build touches are declared; keep member names identical to the generated header.
+ */
+
+#include <pb.h>
+
+typedef enum _socket_message_ModesEnum {
+    socket_message_ModesEnum_DEACTIVATED = 0,
+    socket_message_ModesEnum_IDLE = 1,
+    socket_message_ModesEnum_CALIBRATION = 2,
+    socket_message_ModesEnum_REST = 3,
+    socket_message_ModesEnum_STAND = 4,
+    socket_message_ModesEnum_WALK = 5
+} socket_message_ModesEnum;
+
+typedef enum _socket_message_WalkGaits {
+    socket_message_WalkGaits_TROT = 0,
+    socket_message_WalkGaits_CRAWL = 1
+} socket_message_WalkGaits;
+
+typedef struct _socket_message_Vector {
+    float x;
+    float y;
+} socket_message_Vector;
+
+typedef struct _socket_message_ControllerData {
+    bool has_left;
+    socket_message_Vector left;
+    bool has_right;
+    socket_message_Vector right;
+    float height;
+    float speed;
+    float s1;
+} socket_message_ControllerData;
+
+typedef struct _socket_message_ModeData {
+    socket_message_ModesEnum mode;
+} socket_message_ModeData;
+
+typedef struct _socket_message_WalkGaitData {
+    socket_message_WalkGaits gait;
+} socket_message_WalkGaitData;
+
+typedef struct _socket_message_AnglesData {
+    pb_size_t angles_count;
+    int32_t angles[12];
+} socket_message_AnglesData;
+
+#define socket_message_ControllerData_init_zero {false, {0, 0}, false, {0, 0}, 0, 0, 0}
+#define socket_message_ModeData_init_zero {_socket_message_ModesEnum(0)}
+#define socket_message_WalkGaitData_init_zero {_socket_message_WalkGaits(0)}
@@ -0,0 +1,4 @@
+#pragma once
+
+#define CONFIG_FREERTOS_HZ 1000
+#define CONFIG_FREERTOS_NUMBER_OF_CORES 2
@@ -0,0 +1,38 @@
+#pragma once
+
+/*
+ * Host stand-in for FSPersistencePB: there is no filesystem, so reading applies the factory defaults and writing is
+ * a no-op. The constructor signature matches the firmware template so services compile unchanged.
+ */
+
+#include <template/stateful_service.h>
+#include <template/state_result.h>
+#include <pb.h>
+#include <functional>
+
+#define MOUNT_POINT "/littlefs"
+#define SERVO_SETTINGS_FILE MOUNT_POINT "/config/servoSettings.pb"
+#define PERIPHERAL_SETTINGS_FILE MOUNT_POINT "/config/peripheralSettings.pb"
+
+template <class T>
+class FSPersistencePB {
+  public:
+    using ProtoStateReader = std::function<void(const T &, T &)>;
+    using ProtoStateUpdater = std::function<StateUpdateResult(const T &, T &)>;
+
+    FSPersistencePB(ProtoStateReader, ProtoStateUpdater stateUpdater, StatefulService<T> *statefulService, const char *,
+                    const pb_msgdesc_t *, size_t, const T &defaultState)
+        : _stateUpdater(stateUpdater), _statefulService(statefulService), _defaultState(defaultState) {}
+
+    void readFromFS() {
+        _statefulService->updateWithoutPropagation(
+            [this](T &state) { return _stateUpdater(_defaultState, state); });
+    }
+
+    bool writeToFS() { return true; }
+
+  private:
+    ProtoStateUpdater _stateUpdater;
+    StatefulService<T> *_statefulService;
+    T _defaultState;
+};
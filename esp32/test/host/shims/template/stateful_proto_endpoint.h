@@ -0,0 +1,23 @@
+#pragma once
+
+/*
+ * Host stand-in for StatefulProtoEndpoint. There is no HTTP server on the host, so the endpoint only keeps the
+ * constructor shape of the firmware template.
+ */
+
+#include <template/stateful_service.h>
+#include <functional>
+
+template <class T, class ProtoT>
+class StatefulProtoEndpoint {
+  public:
+    using ProtoStateReader = std::function<void(const T &, ProtoT &)>;
+    using ProtoStateUpdater = std::function<StateUpdateResult(const ProtoT &, T &)>;
+
+    template <class RequestExtractor, class ResponseAssigner>
+    StatefulProtoEndpoint(ProtoStateReader, ProtoStateUpdater, StatefulService<T> *, RequestExtractor,
+                          ResponseAssigner) {}
+};
+
+#define API_REQUEST_EXTRACTOR(field_name, proto_type) nullptr
+#define API_RESPONSE_ASSIGNER(field_name, proto_type) nullptr
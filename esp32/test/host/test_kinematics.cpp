@@ -0,0 +1,257 @@
+#include "host_test.h"
+#include "pose_batch.h"
+
+#include <motion.h>
+
+#include <type_traits>
+
+static bool allFinite(const float *values, size_t n) {
+    for (size_t i = 0; i < n; i++)
+        if (!std::isfinite(values[i])) return false;
+    return true;
+}
+
+static void test_ik_default_stance_is_symmetric() {
+    Kinematics<> kinematics;
+    body_state_t body;
+    body.updateFeet(KinConfig::default_feet_positions);
+    float angles[12];
+    CHECK(kinematics.calculate_inverse_kinematics(body, angles) == ESP_OK);
+    CHECK(allFinite(angles, 12));
+    // Left and right legs mirror each other, front and back legs match.
+    for (int j = 0; j < 3; j++) {
+        CHECK_NEAR(angles[0 + j], angles[3 + j], 1e-3);
+        CHECK_NEAR(angles[0 + j], angles[6 + j], 1e-3);
+        CHECK_NEAR(angles[3 + j], angles[9 + j], 1e-3);
+    }
+}
+
+static void checkBatchMatchesScalar(const std::vector<body_state_t> &states) {
+    PoseBatch batch;
+    for (const auto &body : states) batch.push(body);
+    std::vector<float> batched(states.size() * 12);
+    Kinematics<>::calculate_inverse_kinematics_batch(batch.view(), batched.data());
+    CHECK(allFinite(batched.data(), batched.size()));
+
+    float max_err = 0;
+    for (size_t i = 0; i < states.size(); i++) {
+        Kinematics<> kinematics;
+        float scalar[12];
+        kinematics.calculate_inverse_kinematics(states[i], scalar);
+        for (int j = 0; j < 12; j++) max_err = std::max(max_err, std::fabs(scalar[j] - batched[i * 12 + j]));
+    }
+    CHECK_NEAR(max_err, 0, 1e-3);
+}
+
+static void test_batch_matches_scalar_walk() { checkBatchMatchesScalar(recordWalk(1000)); }
+
+static void test_batch_matches_scalar_random() { checkBatchMatchesScalar(randomPoses(1000)); }
+
+static void test_batch_handles_partial_blocks() {
+    for (size_t count : {0, 1, 63, 65, 130}) checkBatchMatchesScalar(randomPoses(count, count + 7));
+}
+
+static void checkMatchesFreshSolve(const body_state_t &body, const float *angles) {
+    Kinematics<> fresh;
+    float expected[12];
+    fresh.calculate_inverse_kinematics(body, expected);
+    for (int j = 0; j < 12; j++) CHECK_NEAR(angles[j], expected[j], 0.01);
+}
+
+static void test_incremental_skips_unchanged_legs() {
+    Kinematics<> kinematics;
+    body_state_t body;
+    body.updateFeet(KinConfig::default_feet_positions);
+    float angles[12];
+
+    kinematics.calculate_inverse_kinematics(body, angles);
+    CHECK(kinematics.stats().last_legs_solved == 4);
+
+    kinematics.calculate_inverse_kinematics(body, angles);
+    CHECK(kinematics.stats().last_legs_solved == 0);
+    checkMatchesFreshSolve(body, angles);
+
+    body.feet[2][1] += 0.02f;
+    kinematics.calculate_inverse_kinematics(body, angles);
+    CHECK(kinematics.stats().last_legs_solved == 1);
+    checkMatchesFreshSolve(body, angles);
+
+    body.omega += 5;
+    kinematics.calculate_inverse_kinematics(body, angles);
+    CHECK(kinematics.stats().last_legs_solved == 4);
+    CHECK(kinematics.stats().pose_updates == 2);
+    CHECK(kinematics.stats().calls == 4);
+    CHECK(kinematics.stats().legs_solved == 9);
+    checkMatchesFreshSolve(body, angles);
+}
+
+static void test_incremental_matches_full_solve_while_walking() {
+    Kinematics<> kinematics;
+    float angles[12];
+    for (const auto &body : recordWalk(500)) {
+        kinematics.calculate_inverse_kinematics(body, angles);
+        checkMatchesFreshSolve(body, angles);
+    }
+}
+
+static void test_incremental_idles_once_stand_settles() {
+    host_clock::useManualClock(true);
+    Peripherals peripherals;
+    MotionService motion;
+    motion.begin();
+    socket_message_ModeData mode = {socket_message_ModesEnum_STAND};
+    motion.handleMode(mode);
+    for (int i = 0; i < 1000; i++) {
+        host_clock::advance(10000);
+        motion.update(&peripherals);
+    }
+    CHECK(motion.kinematicsStats().last_legs_solved == 0);
+    host_clock::useManualClock(false);
+}
+
+template <class Variant = KinVariant>
+static float roundTripError(const body_state_t &body, float world[4][3]) {
+    Kinematics<Variant> kinematics;
+    float angles[12];
+    kinematics.calculate_inverse_kinematics(body, angles);
+    Kinematics<Variant>::calculate_forward_kinematics(body, angles, nullptr, world);
+    float err = 0;
+    for (int leg = 0; leg < 4; leg++)
+        for (int axis = 0; axis < 3; axis++) err = std::max(err, std::fabs(world[leg][axis] - body.feet[leg][axis]));
+    return err;
+}
+
+// Random targets may be out of reach, so round-trip the reachable feet that FK lands on instead.
+template <class Variant>
+static void checkRoundTripRandom() {
+    float world[4][3];
+    for (auto body : randomPoses<Variant>(500, 3)) {
+        roundTripError<Variant>(body, world);
+        for (int leg = 0; leg < 4; leg++)
+            for (int axis = 0; axis < 3; axis++) body.feet[leg][axis] = world[leg][axis];
+        CHECK_NEAR(roundTripError<Variant>(body, world), 0, 1e-4);
+    }
+}
+
+static void test_forward_kinematics_inverts_ik() {
+    float world[4][3];
+    for (const auto &body : recordWalk(500)) CHECK_NEAR(roundTripError(body, world), 0, 1e-4);
+
+    checkRoundTripRandom<SpotMicroESP32>();
+    checkRoundTripRandom<SpotMicroESP32Mini>();
+    checkRoundTripRandom<SpotMicroYertle>();
+}
+
+template <class Variant>
+static void checkLegJacobian() {
+    body_state_t body;
+    for (const auto &pose : randomPoses<Variant>(100, 5)) {
+        Kinematics<Variant> kinematics;
+        float angles[12];
+        kinematics.calculate_inverse_kinematics(pose, angles);
+        for (int leg = 0; leg < 4; leg++) {
+            float J[3][3];
+            Kinematics<Variant>::legJacobian(leg, angles + leg * 3, J);
+            for (int joint = 0; joint < 3; joint++) {
+                const float step_deg = 0.01f;
+                float plus[12], minus[12];
+                std::copy(angles, angles + 12, plus);
+                std::copy(angles, angles + 12, minus);
+                plus[leg * 3 + joint] += step_deg;
+                minus[leg * 3 + joint] -= step_deg;
+                float fp[4][3], fm[4][3];
+                Kinematics<Variant>::calculate_forward_kinematics(body, plus, fp);
+                Kinematics<Variant>::calculate_forward_kinematics(body, minus, fm);
+                const float step_rad = DEG_TO_RAD_F(2 * step_deg);
+                for (int axis = 0; axis < 3; axis++)
+                    CHECK_NEAR(J[axis][joint], (fp[leg][axis] - fm[leg][axis]) / step_rad, 2e-3);
+            }
+        }
+    }
+}
+
+static void test_leg_jacobian_matches_finite_differences() {
+    checkLegJacobian<SpotMicroESP32>();
+    checkLegJacobian<SpotMicroESP32Mini>();
+    checkLegJacobian<SpotMicroYertle>();
+}
+
+// Yertle geometry with the femur-relative knee mapping of the other builds.
+struct YertleRelativeKnee : SpotMicroYertle {
+    static constexpr bool absolute_tibia = false;
+};
+
+static void test_variants_share_one_build() {
+    // The build-selected robot is just the default template argument.
+    CHECK((std::is_same_v<Kinematics<>, Kinematics<KinVariant>>));
+    static_assert(KinematicsConfig<SpotMicroYertle>::max_leg_reach == 0.26f);
+    static_assert(KinematicsConfig<SpotMicroESP32Mini>::max_leg_reach == 0.12f);
+
+    for (const auto &body : randomPoses<SpotMicroYertle>(100, 9)) {
+        float absolute[12], relative[12];
+        Kinematics<SpotMicroYertle>().calculate_inverse_kinematics(body, absolute);
+        Kinematics<YertleRelativeKnee>().calculate_inverse_kinematics(body, relative);
+        for (int leg = 0; leg < 4; leg++) {
+            CHECK_NEAR(absolute[leg * 3 + 0], relative[leg * 3 + 0], 1e-4);
+            CHECK_NEAR(absolute[leg * 3 + 1], relative[leg * 3 + 1], 1e-4);
+            CHECK_NEAR(absolute[leg * 3 + 2], relative[leg * 3 + 1] + relative[leg * 3 + 2], 1e-3);
+        }
+    }
+}
+
+static void test_fast_trig_accuracy_over_workspace() {
+    constexpr float reach = KinConfig::femur + KinConfig::tibia + KinConfig::coxa;
+    constexpr int steps = 60;
+    float max_err[3] = {0, 0, 0};
+    for (int i = 0; i <= steps; i++) {
+        for (int j = 0; j <= steps; j++) {
+            for (int k = 0; k <= steps; k++) {
+                const float x = -reach + 2 * reach * i / steps;
+                const float y = -reach + 2 * reach * j / steps;
+                const float z = -reach + 2 * reach * k / steps;
+                if (x * x + y * y + z * z > reach * reach) continue;
+                float exact[3], fast[3];
+                Kinematics<>::legIK<StdTrig>(x, y, z, exact);
+                Kinematics<>::legIK<FastTrig>(x, y, z, fast);
+                for (int a = 0; a < 3; a++) {
+                    // theta1 wraps at +-180 deg when the foot is behind the hip
+                    float err = std::fabs(std::remainder(exact[a] - fast[a], 360.0f));
+                    max_err[a] = std::max(max_err[a], err);
+                }
+            }
+        }
+    }
+    printf("  fast legIK max error: %.4f / %.4f / %.4f deg\n", max_err[0], max_err[1], max_err[2]);
+    for (float err : max_err) CHECK(err < 0.01f);
+
+    float max_rot_err = 0;
+    for (float roll = -45; roll <= 45; roll += 1.5f) {
+        for (float pitch = -45; pitch <= 45; pitch += 1.5f) {
+            for (float yaw = -180; yaw <= 180; yaw += 6) {
+                float exact[3][3], fast[3][3];
+                Kinematics<>::euler2R<StdTrig>(DEG_TO_RAD_F(roll), DEG_TO_RAD_F(pitch), DEG_TO_RAD_F(yaw), exact);
+                Kinematics<>::euler2R<FastTrig>(DEG_TO_RAD_F(roll), DEG_TO_RAD_F(pitch), DEG_TO_RAD_F(yaw), fast);
+                for (int r = 0; r < 3; r++)
+                    for (int c = 0; c < 3; c++)
+                        max_rot_err = std::max(max_rot_err, std::fabs(exact[r][c] - fast[r][c]));
+            }
+        }
+    }
+    printf("  fast euler2R max error: %.2e\n", max_rot_err);
+    CHECK(max_rot_err < 2e-5f);
+}
+
+int main() {
+    RUN_TEST(test_ik_default_stance_is_symmetric);
+    RUN_TEST(test_batch_matches_scalar_walk);
+    RUN_TEST(test_batch_matches_scalar_random);
+    RUN_TEST(test_batch_handles_partial_blocks);
+    RUN_TEST(test_incremental_skips_unchanged_legs);
+    RUN_TEST(test_incremental_matches_full_solve_while_walking);
+    RUN_TEST(test_incremental_idles_once_stand_settles);
+    RUN_TEST(test_forward_kinematics_inverts_ik);
+    RUN_TEST(test_leg_jacobian_matches_finite_differences);
+    RUN_TEST(test_variants_share_one_build);
+    RUN_TEST(test_fast_trig_accuracy_over_workspace);
+    return host_test::failures;
+}
@@ -0,0 +1,972 @@
+#include "host_test.h"
+#include "command_replay.h"
+
+#include <motion.h>
+#include <peripherals/servo_controller.h>
+#include <utils/mailbox.h>
+#include <utils/loop_profiler.h>
+#include <utils/loop_timer.h>
+#include <utils/flight_recorder.h>
+#include <utils/trace.h>
+#include <utils/task_stats.h>
+
+// imu.h's <features.h> resolves to libc's on the host (see CMakeLists.txt), so the IMU build is selected here.
+#define FT_ENABLED(feature) feature
+#define USE_MPU6050 0
+#define USE_BNO055 1
+#include <peripherals/imu.h>
+
+#include <array>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+static bool allFinite(const float *values, int n) {
+    for (int i = 0; i < n; i++)
+        if (!std::isfinite(values[i])) return false;
+    return true;
+}
+
+static void test_walk_moves_feet() {
+    WalkState walk;
+    MotionState &state = walk;
+    CommandMsg cmd = {0, 0.8f, 0, 0, 0.5f, 1.0f, 0.5f};
+    state.handleCommand(cmd);
+    body_state_t body;
+    body.updateFeet(KinConfig::default_feet_positions);
+
+    float min_y = 1, max_y = -1;
+    for (int i = 0; i < 500; i++) {
+        state.step(body, 0.01f);
+        for (int leg = 0; leg < 4; leg++) {
+            min_y = std::min(min_y, body.feet[leg][1]);
+            max_y = std::max(max_y, body.feet[leg][1]);
+        }
+    }
+    CHECK(max_y > 0.01f);
+    CHECK(min_y <= 0.0f);
+}
+
+static constexpr float SWING_STEPS[12] = {-1.0f, -1.4f, -1.5f, -1.5f, -1.5f, 0.0f, 0.0f, 0.0f, 1.5f, 1.5f, 1.4f, 1.0f};
+static constexpr float SWING_HEIGHTS[12] = {0.0f, 0.0f, 0.9f, 0.9f, 0.9f, 0.9f, 0.9f, 1.1f, 1.1f, 1.1f, 0.0f, 0.0f};
+
+// The per-tick Bernstein sum WalkState used before the lookup tables.
+static void legacyBezierCurve(float length, float angle, float height, float phase, float *point) {
+    const float t = std::clamp(phase, 1e-4f, 1.f - 1e-4f);
+    float phase_power = 1.0f;
+    float inv_phase_power = std::pow(1.0f - t, 11);
+    for (int i = 0; i < 12; i++) {
+        float b = combinatorial_constexpr(11, i) * phase_power * inv_phase_power;
+        point[0] += b * SWING_STEPS[i] * length * std::cos(angle);
+        point[1] += b * SWING_HEIGHTS[i] * height;
+        point[2] += b * SWING_STEPS[i] * length * std::sin(angle);
+        phase_power *= t;
+        inv_phase_power /= 1.0f - t;
+    }
+}
+
+static void test_swing_table_matches_bezier() {
+    using Exact = BezierTable<12, 1>;
+    const float length = KinConfig::max_step_length * 0.5f;
+    const float height = KinConfig::max_step_height;
+    float max_exact_err = 0, max_legacy_err = 0;
+    for (int i = 0; i <= 10000; i++) {
+        const float phase = i / 10000.0f;
+        for (float angle : {0.0f, 0.7f, -2.0f}) {
+            float actual[3] = {0, 0, 0};
+            BezierSwingCurve::apply(length, angle, height, phase, actual);
+            const float step = Exact::evaluate(SWING_STEPS, phase) * length;
+            const float exact[3] = {step * std::cos(angle), (float)Exact::evaluate(SWING_HEIGHTS, phase) * height,
+                                    step * std::sin(angle)};
+            for (int axis = 0; axis < 3; axis++)
+                max_exact_err = std::max(max_exact_err, std::fabs(exact[axis] - actual[axis]));
+
+            // (1 - t)^11 underflows near the end of the swing, so the legacy sum is only a reference in between.
+            if (phase < 0.01f || phase > 0.99f) continue;
+            float legacy[3] = {0, 0, 0};
+            legacyBezierCurve(length, angle, height, phase, legacy);
+            for (int axis = 0; axis < 3; axis++)
+                max_legacy_err = std::max(max_legacy_err, std::fabs(legacy[axis] - actual[axis]));
+        }
+    }
+    printf("  swing table max error: %.1f um exact, %.1f um legacy (resolution %d)\n", max_exact_err * 1e6f,
+           max_legacy_err * 1e6f, WALK_BEZIER_RESOLUTION);
+    const float tolerance = 1e-3f * std::max(length, height);
+    CHECK(max_exact_err < tolerance);
+    CHECK(max_legacy_err < tolerance);
+}
+
+static void test_motion_service_update_uses_clock() {
+    host_clock::useManualClock(true);
+    host_clock::setTime(0);
+    Peripherals peripherals;
+    MotionService motion;
+    motion.begin();
+    CHECK(!motion.update(&peripherals));
+
+    socket_message_ModeData mode = {socket_message_ModesEnum_STAND};
+    motion.handleMode(mode);
+    // The control loop applies the mode at its next tick.
+    CHECK(!motion.isActive());
+    // Joints start from rest and accelerate, so the first tick moves them less than the 0.1 degree report threshold.
+    host_clock::advance(10000);
+    motion.update(&peripherals);
+    CHECK(motion.isActive());
+    host_clock::advance(10000);
+    CHECK(motion.update(&peripherals));
+    CHECK(allFinite(motion.getAngles(), 12));
+
+    peripherals.setGesture(eGestureDown);
+    host_clock::advance(10000);
+    motion.update(&peripherals);
+    CHECK(motion.isActive());
+    host_clock::useManualClock(false);
+}
+
+// Steps one axis from 0 to `target` at the given rate and reports when it got within 0.01 of it.
+struct step_response_t {
+    float arrival, max_velocity, max_acceleration, overshoot;
+};
+
+static step_response_t stepResponse(const joint_limits_t &limits, float hz, float target) {
+    TrajectoryGenerator<1> trajectory;
+    trajectory.setLimits(limits);
+    const float start = 0;
+    trajectory.reset(&start);
+    const float dt = 1 / hz;
+    step_response_t response {-1, 0, 0, 0};
+    float last_velocity = 0;
+    for (int i = 0; i < hz * 3; i++) {
+        trajectory.update(&target, dt);
+        const float velocity = trajectory.velocity(0);
+        response.max_velocity = std::max(response.max_velocity, std::fabs(velocity));
+        response.max_acceleration = std::max(response.max_acceleration, std::fabs(velocity - last_velocity) / dt);
+        response.overshoot = std::max(response.overshoot, trajectory.positions()[0] - target);
+        if (response.arrival < 0 && std::fabs(trajectory.positions()[0] - target) < 0.01f)
+            response.arrival = (i + 1) * dt;
+        last_velocity = velocity;
+    }
+    CHECK_NEAR(trajectory.positions()[0], target, 1e-3f);
+    return response;
+}
+
+static void test_trajectory_is_rate_independent() {
+    const joint_limits_t limits {120, 600};
+    // Ideal: accelerate for 0.2 s, cruise 0.3 s, brake 0.2 s.
+    for (float hz : {50.0f, 100.0f, 400.0f, 1000.0f}) {
+        const step_response_t response = stepResponse(limits, hz, 60);
+        CHECK_NEAR(response.arrival, 0.7f, 0.03f);
+        CHECK(response.max_velocity <= 120.0f + 1e-3f);
+        CHECK(response.max_acceleration <= 600.0f * 1.001f);
+        CHECK(response.overshoot < 1e-4f);
+    }
+}
+
+static void test_trajectory_jerk_limit() {
+    const joint_limits_t limits {120, 600, 3000};
+    for (float hz : {50.0f, 100.0f, 400.0f}) {
+        const step_response_t response = stepResponse(limits, hz, 60);
+        CHECK(response.arrival > 0.7f && response.arrival < 1.5f);
+        CHECK(response.max_velocity <= 120.0f + 1e-3f);
+        CHECK(response.max_acceleration <= 600.0f * 1.001f);
+        CHECK(response.overshoot < 1e-3f);
+    }
+}
+
+static void test_trajectory_tracks_target_within_limits() {
+    TrajectoryGenerator<1> trajectory;
+    trajectory.setLimits({120, 600});
+    const float start = 0;
+    trajectory.reset(&start);
+    // 10 degrees at 0.5 Hz peaks at 31 deg/s and 99 deg/s^2, inside the limits, so there is no lag once locked on.
+    float worst = 0;
+    for (int i = 1; i <= 400; i++) {
+        const float target = 10 * std::sin(2 * M_PI * 0.5f * i * 0.01f);
+        trajectory.update(&target, 0.01f);
+        if (i > 100) worst = std::max(worst, std::fabs(trajectory.positions()[0] - target));
+    }
+    CHECK(worst < 0.01f);
+}
+
+static void test_motion_service_limits_joint_speed() {
+    host_clock::useManualClock(true);
+    host_clock::setTime(0);
+    Peripherals peripherals;
+    MotionService motion;
+    motion.begin();
+    socket_message_ModeData mode = {socket_message_ModesEnum_STAND};
+    motion.handleMode(mode);
+
+    float last[12];
+    std::copy(motion.getAngles(), motion.getAngles() + 12, last);
+    float fastest = 0;
+    for (int i = 0; i < 300; i++) {
+        host_clock::advance(10000);
+        motion.update(&peripherals);
+        for (int j = 0; j < 12; j++) {
+            fastest = std::max(fastest, std::fabs(motion.getAngles()[j] - last[j]) / 0.01f);
+            last[j] = motion.getAngles()[j];
+        }
+    }
+    CHECK(fastest > 0 && fastest <= 120.0f + 1e-3f);
+    host_clock::useManualClock(false);
+}
+
+static void test_update_angles_follows_small_moves() {
+    MotionService motion;
+    float angles[12] = {};
+    float next[12] = {};
+    next[3] = 0.05f;
+    // Below the report threshold: not reported as a change, but the output still moves.
+    CHECK(!motion.update_angles(next, angles));
+    CHECK_NEAR(angles[3], 0.05f, 1e-6);
+    next[3] = 0.5f;
+    CHECK(motion.update_angles(next, angles));
+    CHECK_NEAR(angles[3], 0.5f, 1e-6);
+}
+
+static void test_loop_timer_wakes_at_rate() {
+    host_clock::useManualClock(true);
+    host_clock::setTime(0);
+    LoopTimer timer;
+    CHECK(timer.start(250) == ESP_OK);
+    CHECK(timer.periodUs() == 4000);
+    for (int i = 1; i <= 10; i++) {
+        CHECK_NEAR(timer.wait(), 0.004f, 1e-6f);
+        CHECK(esp_timer_get_time() == i * 4000);
+    }
+
+    // A tick that overruns three periods wakes straight away, with the periods it slept through counted as missed.
+    host_clock::advance(3 * 4000 + 100);
+    CHECK_NEAR(timer.wait(), 0.0121f, 1e-6f);
+    CHECK(timer.missed() == 2);
+    CHECK_NEAR(timer.wait(), 0.0039f, 1e-6f);
+    CHECK(esp_timer_get_time() == 56000);
+
+    // Rates are clamped to what the loop supports, and a change takes effect one new period later.
+    CHECK(timer.setRate(1000) == ESP_OK);
+    CHECK(timer.rateHz() == LoopTimer::MAX_RATE_HZ);
+    CHECK_NEAR(timer.wait(), 0.002f, 1e-6f);
+    CHECK(timer.setRate(1) == ESP_OK);
+    CHECK(timer.periodUs() == 1000000 / LoopTimer::MIN_RATE_HZ);
+    CHECK(timer.missed() == 2);
+    timer.stop();
+    CHECK(timer.start(100) == ESP_OK);
+    CHECK(timer.start(100) == ESP_ERR_INVALID_STATE);
+    host_clock::useManualClock(false);
+}
+
+// Angles after standing up for `seconds`, with the motion stack woken by a LoopTimer at rate_hz.
+static std::array<float, 12> standUpAt(uint32_t rate_hz, float seconds) {
+    host_clock::setTime(0);
+    Peripherals peripherals;
+    MotionService motion;
+    motion.begin();
+    socket_message_ModeData mode = {socket_message_ModesEnum_STAND};
+    motion.handleMode(mode);
+    LoopTimer timer;
+    timer.start(rate_hz);
+    while (esp_timer_get_time() < seconds * 1e6f) motion.update(&peripherals, timer.wait());
+    std::array<float, 12> angles;
+    std::copy(motion.getAngles(), motion.getAngles() + 12, angles.begin());
+    return angles;
+}
+
+static void test_motion_service_is_loop_rate_independent() {
+    host_clock::useManualClock(true);
+    // 0.2 s into standing up the joints are still tens of degrees out, so this compares the trajectories, not end
+    // points. At full joint speed a 50 Hz tick is 2.4 degrees.
+    const std::array<float, 12> reference = standUpAt(100, 0.2f);
+    for (uint32_t hz : {50u, 250u, 500u}) {
+        const std::array<float, 12> angles = standUpAt(hz, 0.2f);
+        for (int i = 0; i < 12; i++) CHECK_NEAR(angles[i], reference[i], 1.0f);
+    }
+    host_clock::useManualClock(false);
+}
+
+static void test_mailbox_latest_value_wins() {
+    Mailbox<int> mailbox;
+    CHECK(mailbox.take() == nullptr);
+    mailbox.post(1, 100);
+    mailbox.post(2, 200);
+    mailbox.post(3, 300);
+    const auto *msg = mailbox.take();
+    CHECK(msg && msg->value == 3 && msg->timestamp == 300 && msg->sequence == 3);
+    CHECK(mailbox.take() == nullptr);
+    mailbox.post(4, 400);
+    msg = mailbox.take();
+    CHECK(msg && msg->value == 4 && msg->sequence == 4);
+}
+
+static void test_mailbox_reads_are_never_torn() {
+    struct Wide {
+        uint32_t words[32];
+    };
+    Mailbox<Wide> mailbox;
+    std::atomic<bool> started {false}, done {false};
+    constexpr uint32_t posts = 200000;
+    std::thread producer([&] {
+        while (!started) std::this_thread::yield();
+        Wide value;
+        for (uint32_t n = 1; n <= posts; n++) {
+            for (uint32_t &word : value.words) word = n;
+            mailbox.post(value, n);
+            if (n % 64 == 0) std::this_thread::yield();
+        }
+        done = true;
+    });
+
+    uint32_t torn = 0, reordered = 0, received = 0, last = 0;
+    started = true;
+    while (!done || last != posts) {
+        const auto *msg = mailbox.take();
+        if (!msg) continue;
+        received++;
+        for (uint32_t word : msg->value.words)
+            if (word != msg->sequence) torn++;
+        if (msg->sequence <= last || msg->timestamp != msg->sequence) reordered++;
+        last = msg->sequence;
+    }
+    producer.join();
+    printf("  consumed %u of %u posts\n", received, posts);
+    CHECK(torn == 0);
+    CHECK(reordered == 0);
+    CHECK(last == posts);
+}
+
+static void test_motion_service_applies_input_once_per_tick() {
+    host_clock::useManualClock(true);
+    host_clock::setTime(1000000);
+    Peripherals peripherals;
+    MotionService motion;
+    motion.begin();
+    socket_message_ModeData mode = {socket_message_ModesEnum_WALK};
+    motion.handleMode(mode);
+
+    socket_message_ControllerData input = socket_message_ControllerData_init_zero;
+    input.has_left = true;
+    for (int i = 0; i < 3; i++) {
+        input.left = {0, 0.2f * (i + 1)};
+        motion.handleInput(input);
+        host_clock::advance(1000);
+    }
+    host_clock::advance(7000);
+    motion.update(&peripherals);
+    // Only the newest of the three commands is applied, 8 ms after it was posted.
+    CHECK(motion.commandLatency() == 8000);
+    CHECK(motion.droppedCommands() == 2);
+
+    host_clock::advance(10000);
+    motion.update(&peripherals);
+    CHECK(motion.commandLatency() == 8000);
+    host_clock::useManualClock(false);
+}
+
+static void test_command_log_round_trip() {
+    const char *path = "command_log_round_trip.bin";
+    host_clock::useManualClock(true);
+    host_clock::setTime(5000);
+    {
+        command_log::Recorder recorder;
+        recorder.recordMode(socket_message_ModesEnum_STAND); // not recording yet
+        CHECK(recorder.start(path));
+        const CommandMsg input = {0.1f, -0.2f, 0.3f, 0, 0.5f, 0.25f, 1};
+        host_clock::advance(1500);
+        recorder.recordInput(input);
+        host_clock::advance(100);
+        recorder.recordInput(input); // unchanged, skipped
+        recorder.recordMode(socket_message_ModesEnum_WALK);
+        recorder.flush();
+        recorder.recordWalkGait(socket_message_WalkGaits_CRAWL);
+        const int32_t angles[3] = {10, -90, 145};
+        recorder.recordAngles(angles, 3);
+        host_clock::advance(20000);
+        recorder.recordLinkLost();
+        recorder.recordInput(input); // the link loss zeroed the sticks, so this is new again
+        recorder.recordGesture(eGestureUp);
+        CHECK(recorder.dropped() == 0);
+        recorder.stop();
+        CHECK(!recorder.recording());
+    }
+    host_clock::useManualClock(false);
+
+    command_log::Reader reader;
+    CHECK(reader.open(path));
+    command_log::record_t record;
+    const command_log::Type expected[] = {command_log::Type::CONTROLLER, command_log::Type::MODE,
+                                          command_log::Type::WALK_GAIT,  command_log::Type::ANGLES,
+                                          command_log::Type::LINK_LOST,  command_log::Type::CONTROLLER,
+                                          command_log::Type::GESTURE};
+    const int64_t times[] = {1500, 1600, 1600, 1600, 21600, 21600, 21600};
+    for (int i = 0; i < 7; i++) {
+        CHECK(reader.next(record));
+        CHECK(record.type == expected[i]);
+        CHECK(record.time_us == times[i]);
+        if (i == 0) CHECK(record.input.ly == -0.2f && record.input.s == 0.25f && record.input.s1 == 1);
+        if (i == 1) CHECK(record.mode == socket_message_ModesEnum_WALK);
+        if (i == 2) CHECK(record.gait == socket_message_WalkGaits_CRAWL);
+        if (i == 3) CHECK(record.angle_count == 3 && record.angles[1] == -90 && record.angles[2] == 145);
+        if (i == 6) CHECK(record.gesture == eGestureUp);
+    }
+    CHECK(!reader.next(record));
+    std::remove(path);
+}
+
+// A session recorded from a live control loop replays to the same joint angles, tick for tick.
+static void test_command_replay_matches_live_run() {
+    const char *path = "command_replay_live.bin";
+    host_clock::useManualClock(true);
+    host_clock::setTime(0);
+    std::vector<std::array<float, 12>> live;
+    {
+        command_log::Recorder recorder;
+        Peripherals peripherals;
+        MotionService motion;
+        motion.begin();
+        motion.setRecorder(&recorder);
+        CHECK(recorder.start(path));
+        LoopTimer timer;
+        timer.start(100);
+        socket_message_ControllerData input = socket_message_ControllerData_init_zero;
+        input.has_left = input.has_right = true;
+        for (int tick = 0; tick < 300; tick++) {
+            // Commands arrive part way through a period, as they do from the websocket task.
+            host_clock::advance(3000);
+            socket_message_ModeData mode = {socket_message_ModesEnum_STAND};
+            if (tick == 10) motion.handleMode(mode);
+            if (tick == 50) {
+                mode.mode = socket_message_ModesEnum_WALK;
+                motion.handleMode(mode);
+            }
+            if (tick >= 60 && tick < 160 && tick % 7 == 0) {
+                input.left = {0.1f * (tick % 3), 0.8f};
+                input.speed = 0.5f + 0.01f * (tick % 11);
+                motion.handleInput(input);
+            }
+            if (tick == 120) motion.handleWalkGait({socket_message_WalkGaits_CRAWL});
+            if (tick == 160) motion.onControlLinkLost();
+            if (tick == 200) peripherals.setGesture(eGestureDown);
+            if (tick % 10 == 0) recorder.flush();
+            motion.update(&peripherals, timer.wait());
+            live.push_back({});
+            std::copy(motion.getAngles(), motion.getAngles() + 12, live.back().begin());
+        }
+        recorder.stop();
+    }
+
+    command_log::Reader reader;
+    CHECK(reader.open(path));
+    size_t ticks = 0, mismatches = 0;
+    replayCommands(reader, 100, 1.0f, [&](const replay_tick_t &tick) {
+        if (ticks < live.size() && !std::equal(tick.angles, tick.angles + 12, live[ticks].begin())) mismatches++;
+        ticks++;
+    });
+    // The log ends with the gesture at 2.01 s and the replay one second later, a tick past the live run.
+    CHECK(ticks == live.size() + 1);
+    CHECK(mismatches == 0);
+    std::remove(path);
+}
+
+static flight_recorder::record_t flightRecord(uint32_t time_us, float tilt = 0, uint8_t missed = 0) {
+    flight_recorder::record_t record = {};
+    record.time_us = time_us;
+    record.missed = missed;
+    record.imu[1] = flight_recorder::centidegrees(tilt);
+    return record;
+}
+
+// Reads a dump back: the header, and the time stamps of its records in file order.
+static bool readFlightDump(const char *path, flight_recorder::file_header_t &header, std::vector<uint32_t> &times) {
+    FILE *file = fopen(path, "rb");
+    if (!file) return false;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1;
+    flight_recorder::record_t record;
+    times.clear();
+    while (ok && fread(&record, sizeof(record), 1, file) == 1) times.push_back(record.time_us);
+    fclose(file);
+    std::remove(path);
+    return ok && times.size() == header.count;
+}
+
+static void test_flight_recorder_dumps_ring_oldest_first() {
+    const char *path = "flight_ring.bin";
+    flight_recorder::Recorder recorder;
+    CHECK(recorder.begin(8));
+    CHECK(!recorder.dump(path)); // nothing frozen
+    for (uint32_t i = 0; i < 20; i++) recorder.record(flightRecord(i));
+    recorder.freeze();
+    CHECK(!recorder.frozen());
+    recorder.record(flightRecord(20)); // a manual freeze stops on the next tick
+    CHECK(recorder.frozen());
+    recorder.record(flightRecord(21)); // ignored while frozen
+
+    CHECK(recorder.dump(path));
+    CHECK(!recorder.frozen());
+    flight_recorder::file_header_t header;
+    std::vector<uint32_t> times;
+    CHECK(readFlightDump(path, header, times));
+    CHECK(std::memcmp(header.magic, "SPFR", 4) == 0);
+    CHECK(header.record_size == sizeof(flight_recorder::record_t));
+    CHECK(header.trigger == flight_recorder::MANUAL);
+    CHECK(header.count == 8 && header.trigger_index == 7);
+    for (uint32_t i = 0; i < times.size(); i++) CHECK(times[i] == 13 + i);
+
+    // Re-armed with an empty ring.
+    for (uint32_t i = 100; i < 103; i++) recorder.record(flightRecord(i));
+    recorder.freeze();
+    recorder.record(flightRecord(103));
+    CHECK(recorder.dump(path));
+    CHECK(readFlightDump(path, header, times));
+    CHECK(header.count == 4 && times.front() == 100);
+}
+
+static void test_flight_recorder_triggers() {
+    const char *path = "flight_trigger.bin";
+    flight_recorder::Recorder recorder;
+    CHECK(recorder.begin(400));
+    uint32_t t = 0;
+    for (int i = 0; i < 50; i++) recorder.record(flightRecord(t++, 10));
+    // Tipping past the limit keeps recording for the post-trigger ticks, then freezes.
+    recorder.record(flightRecord(t++, -50));
+    for (int i = 0; i < FLIGHT_RECORDER_POST_TRIGGER - 1; i++) recorder.record(flightRecord(t++, -80));
+    CHECK(!recorder.frozen());
+    recorder.record(flightRecord(t++, -80));
+    CHECK(recorder.frozen());
+    CHECK(recorder.trigger() == flight_recorder::TILT);
+    CHECK(recorder.dump(path));
+    flight_recorder::file_header_t header;
+    std::vector<uint32_t> times;
+    CHECK(readFlightDump(path, header, times));
+    CHECK(header.count == 51 + FLIGHT_RECORDER_POST_TRIGGER && header.trigger_index == 50);
+    CHECK(times[header.trigger_index] == 50);
+
+    // Still lying on its side after the dump: the tilt has to clear before it can trigger again.
+    for (int i = 0; i < 300; i++) recorder.record(flightRecord(t++, -80));
+    CHECK(!recorder.frozen());
+    recorder.record(flightRecord(t++, 0));
+    recorder.record(flightRecord(t++, 60));
+    for (int i = 0; i < FLIGHT_RECORDER_POST_TRIGGER; i++) recorder.record(flightRecord(t++, 60));
+    CHECK(recorder.frozen() && recorder.trigger() == flight_recorder::TILT);
+    CHECK(recorder.dump(path));
+
+    // A wake that comes late enough.
+    recorder.record(flightRecord(t++, 0, FLIGHT_RECORDER_MISSED_TICKS - 1));
+    recorder.record(flightRecord(t++, 0, FLIGHT_RECORDER_MISSED_TICKS));
+    for (int i = 0; i < FLIGHT_RECORDER_POST_TRIGGER; i++) recorder.record(flightRecord(t++));
+    CHECK(recorder.frozen() && recorder.trigger() == flight_recorder::DEADLINE);
+    CHECK(recorder.dump(path));
+    CHECK(readFlightDump(path, header, times));
+    CHECK(header.trigger_index == 1);
+}
+
+// The IMU reports radians; a tilt past the limit has to trip the recorder once converted like the firmware does.
+static void test_flight_recorder_tilt_from_imu_radians() {
+    flight_recorder::Recorder recorder;
+    CHECK(recorder.begin(64));
+    Peripherals peripherals;
+    auto imuRecord = [&](uint32_t time_us) {
+        flight_recorder::record_t record = flightRecord(time_us);
+        record.imu[0] = flight_recorder::imuCentidegrees(peripherals.angleX());
+        record.imu[1] = flight_recorder::imuCentidegrees(peripherals.angleY());
+        record.imu[2] = flight_recorder::imuCentidegrees(peripherals.angleZ());
+        return record;
+    };
+    uint32_t t = 0;
+    // 0.6 rad is 34 degrees, inside the limit.
+    peripherals.setAngles(0, 0.6f, 0);
+    for (int i = 0; i < 2 * FLIGHT_RECORDER_POST_TRIGGER; i++) recorder.record(imuRecord(t++));
+    CHECK(!recorder.frozen());
+    // 0.9 rad is 52 degrees.
+    peripherals.setAngles(0.9f, 0, 0);
+    for (int i = 0; i <= FLIGHT_RECORDER_POST_TRIGGER; i++) recorder.record(imuRecord(t++));
+    CHECK(recorder.frozen() && recorder.trigger() == flight_recorder::TILT);
+}
+
+// Same, through a BNO055 on the host I2C bus: it reports degrees, which the IMU hands on as radians.
+static void test_flight_recorder_tilt_from_bno055() {
+    I2CBus::instance().begin(GPIO_NUM_NC, GPIO_NUM_NC);
+    const uint8_t chip_id = 0xA0;
+    host_i2c::setRegisters(BNO055Driver::DEFAULT_ADDR, 0x00, &chip_id, 1);
+    IMU imu;
+    CHECK(imu.initialize());
+    // Euler registers from 0x1A: heading, roll, pitch, 1/16 degree LSB.
+    auto setEuler = [](float heading, float roll, float pitch) {
+        uint8_t euler[6];
+        const float degrees[3] = {heading, roll, pitch};
+        for (int i = 0; i < 3; i++) {
+            const int16_t raw = static_cast<int16_t>(std::lround(degrees[i] * 16));
+            euler[2 * i] = static_cast<uint16_t>(raw) & 0xFF;
+            euler[2 * i + 1] = static_cast<uint16_t>(raw) >> 8;
+        }
+        host_i2c::setRegisters(BNO055Driver::DEFAULT_ADDR, 0x1A, euler, sizeof(euler));
+    };
+
+    flight_recorder::Recorder recorder;
+    CHECK(recorder.begin(64));
+    auto imuRecord = [&](uint32_t time_us) {
+        CHECK(imu.update());
+        flight_recorder::record_t record = flightRecord(time_us);
+        record.imu[0] = flight_recorder::imuCentidegrees(imu.getAngleX());
+        record.imu[1] = flight_recorder::imuCentidegrees(imu.getAngleY());
+        record.imu[2] = flight_recorder::imuCentidegrees(imu.getAngleZ());
+        return record;
+    };
+    uint32_t t = 0;
+    setEuler(170, 30, -20);
+    for (int i = 0; i < 2 * FLIGHT_RECORDER_POST_TRIGGER; i++) {
+        const flight_recorder::record_t record = imuRecord(t++);
+        CHECK(record.imu[0] == 3000 && record.imu[1] == -2000 && record.imu[2] == 17000);
+        recorder.record(record);
+    }
+    CHECK(!recorder.frozen());
+    setEuler(170, 50, 0);
+    for (int i = 0; i <= FLIGHT_RECORDER_POST_TRIGGER; i++) recorder.record(imuRecord(t++));
+    CHECK(recorder.frozen() && recorder.trigger() == flight_recorder::TILT);
+    I2CBus::instance().end();
+}
+
+// Timestamps ("ts") of the events in a Chrome trace file, in file order, and whether it names the host task.
+static bool readTraceTimes(const char *path, std::vector<double> &times, std::string &phases) {
+    FILE *file = fopen(path, "r");
+    if (!file) return false;
+    std::string json;
+    char chunk[512];
+    for (size_t n; (n = fread(chunk, 1, sizeof(chunk), file)) > 0;) json.append(chunk, n);
+    fclose(file);
+    times.clear();
+    phases.clear();
+    for (size_t at = json.find("\"ph\":\""); at != std::string::npos; at = json.find("\"ph\":\"", at + 1)) {
+        const char phase = json[at + 6];
+        if (phase == 'M') continue;
+        phases += phase;
+        times.push_back(std::atof(json.c_str() + json.find("\"ts\":", at) + 5));
+    }
+    return json.find("\"name\":\"main\"") != std::string::npos && json.back() == '\n';
+}
+
+static void test_trace_exports_chrome_json() {
+    const char *path = "trace_test.json";
+    trace::Tracer &tracer = trace::Tracer::instance();
+    CHECK(tracer.begin(16));
+    host_clock::useManualClock(true);
+    // The 32-bit cycle counter wraps at 2^32 / 240 MHz, 17.9 s in; the capture straddles it.
+    const int64_t start_us = 17895000;
+    host_clock::setTime(start_us);
+    CHECK(tracer.start());
+    {
+        trace::Scope outer("outer");
+        host_clock::advance(400);
+        {
+            trace::Scope inner("inner", 42);
+            host_clock::advance(500);
+            tracer.record(trace::COUNTER, "depth", 2);
+        }
+        host_clock::advance(100);
+    }
+    CHECK(tracer.events() == 5);
+    CHECK(tracer.exportJson(path) == 5);
+    CHECK(!tracer.running());
+
+    std::vector<double> times;
+    std::string phases;
+    CHECK(readTraceTimes(path, times, phases));
+    CHECK(phases == "BBCEE");
+    const double expected[] = {0, 400, 900, 900, 1000};
+    for (size_t i = 0; i < times.size() && i < 5; i++) CHECK_NEAR(times[i], start_us + expected[i], 0.01);
+
+    // A full buffer ends the capture; nothing past it is kept.
+    CHECK(tracer.start());
+    for (int i = 0; i < 20; i++) tracer.record(trace::COUNTER, "n", i);
+    CHECK(!tracer.running());
+    CHECK(tracer.events() == 16);
+    CHECK(tracer.exportJson(path) == 16);
+    host_clock::useManualClock(false);
+    std::remove(path);
+}
+
+static void test_task_stats_deltas() {
+    TaskStats stats;
+    // First sample: averages since boot.
+    const task_sample_t boot[] = {{3, "IDLE0", 600, 1000, 0, 0},
+                                  {4, "IDLE1", 900, 1000, 1, 0},
+                                  {9, "Service task", 250, 3000, -1, 2},
+                                  {7, "Control task", 100, 2000, 1, 5}};
+    CHECK(stats.update(boot, 4, 1000) == 4);
+    CHECK(stats.task(0).id == 3 && stats.task(2).id == 7 && stats.task(3).id == 9);
+    CHECK_NEAR(stats.task(3).cpu_percent, 25, 1e-3);
+    CHECK_NEAR(stats.coreUsage(0), 40, 1e-3);
+    CHECK_NEAR(stats.coreUsage(1), 10, 1e-3);
+
+    // The run-time clock and the control task's counter wrap during the interval, the scheduler lists tasks in a
+    // different order, one task has gone and another started.
+    const uint32_t t0 = UINT32_MAX - 499;
+    const task_sample_t before[] = {{3, "IDLE0", 5000, 1000, 0, 0},
+                                    {4, "IDLE1", 7000, 1000, 1, 0},
+                                    {7, "Control task", UINT32_MAX - 99, 1800, 1, 5},
+                                    {9, "Service task", 250, 3000, -1, 2}};
+    stats.update(before, 4, t0);
+    const task_sample_t after[] = {{12, "camera", 50, 4000, 0, 3},
+                                   {7, "Control task", UINT32_MAX - 99 + 700, 1700, 1, 5},
+                                   {4, "IDLE1", 7200, 1000, 1, 0},
+                                   {3, "IDLE0", 5900, 1000, 0, 0}};
+    CHECK(stats.update(after, 4, t0 + 1000) == 4);
+    CHECK(std::strcmp(stats.task(2).name, "Control task") == 0);
+    CHECK_NEAR(stats.task(2).cpu_percent, 70, 1e-3);
+    CHECK(stats.task(2).stack_free == 1700 && stats.task(2).core == 1 && stats.task(2).priority == 5);
+    CHECK(stats.task(3).id == 12);
+    CHECK_NEAR(stats.task(3).cpu_percent, 5, 1e-3);
+    CHECK_NEAR(stats.coreUsage(0), 10, 1e-3);
+    CHECK_NEAR(stats.coreUsage(1), 80, 1e-3);
+    CHECK_NEAR(stats.cpuUsage(), 45, 1e-3);
+}
+
+static void test_latency_histogram_percentiles() {
+    LatencyHistogram histogram;
+    for (uint32_t us = 1; us <= 1000; us++) histogram.record(us);
+    const timing_summary_t summary = histogram.summary();
+    CHECK(summary.min_us == 1);
+    CHECK(summary.max_us == 1000);
+    CHECK(summary.avg_us == 500);
+    // Bucket edges are at most 12.5% wide.
+    CHECK(summary.p99_us >= 990 && summary.p99_us <= 1000);
+
+    for (uint32_t us : {0u, 15u, 16u, 17u, 255u, 256u, 100000u, 5000000u}) {
+        const size_t bucket = LatencyHistogram::bucketOf(us);
+        CHECK(bucket < LatencyHistogram::BUCKETS);
+        if (us < 1000000) CHECK(LatencyHistogram::upperEdge(bucket) >= us);
+        if (bucket > 0 && us < 1000000) CHECK(LatencyHistogram::upperEdge(bucket - 1) < us);
+    }
+}
+
+static void test_loop_profiler_reports_stages_and_jitter() {
+    static constexpr const char *names[2] = {"fast", "slow"};
+    LoopProfiler<2> profiler(names, 10000, 100);
+    int64_t now = 1000000;
+    for (int tick = 0; tick < 100; tick++) {
+        // Every tenth wake is 500 us late, and its slow stage overruns the period.
+        const int64_t wake = now + (tick % 10 == 9 ? 500 : 0);
+        profiler.beginTick(wake);
+        profiler.mark(0, wake + 200);
+        const int64_t slow = tick % 10 == 9 ? 12000 : 3000;
+        profiler.mark(1, wake + 200 + slow);
+        profiler.endTick(wake + 200 + slow);
+        CHECK((profiler.takeReport() != nullptr) == (tick == 99));
+        now += 10000;
+    }
+    profiler.beginTick(now);
+    profiler.endTick(now);
+    CHECK(profiler.takeReport() == nullptr);
+}
+
+static void test_loop_profiler_report_contents() {
+    static constexpr const char *names[1] = {"stage"};
+    LoopProfiler<1> profiler(names, 10000, 10);
+    int64_t now = 0;
+    for (int tick = 0; tick < 10; tick++) {
+        const int64_t wake = now + (tick == 5 ? 300 : 0);
+        profiler.beginTick(wake);
+        profiler.mark(0, wake + (tick == 5 ? 11000 : 1000));
+        profiler.endTick(wake + (tick == 5 ? 11000 : 1000));
+        now += 10000;
+    }
+    const auto *msg = profiler.takeReport();
+    CHECK(msg != nullptr);
+    if (!msg) return;
+    const auto &report = msg->value;
+    CHECK(std::strcmp(profiler.stageName(0), "stage") == 0);
+    CHECK(report.ticks == 10);
+    CHECK(report.overruns == 1);
+    CHECK(report.stages[0].min_us == 1000);
+    CHECK(report.stages[0].max_us == 11000);
+    CHECK(report.stages[0].avg_us == 2000);
+    CHECK(report.busy.max_us == 11000);
+    // The late wake shortens the following interval by the same amount.
+    CHECK(report.jitter.min_us == 0);
+    CHECK(report.jitter.max_us == 300);
+}
+
+// True when the OFF count of all 12 servo channels the PCA9685 received is `pwm`.
+static bool allChannelsAt(int32_t pwm) {
+    const uint8_t *regs = host_i2c::registers(PCA9685Driver::DEFAULT_ADDR);
+    for (int channel = 0; channel < 12; channel++) {
+        const uint8_t *led = regs + 0x06 + 4 * channel; // LEDn_ON_L, ON_H, OFF_L, OFF_H
+        if ((led[2] | (led[3] & 0x0F) << 8) != pwm) return false;
+    }
+    return true;
+}
+
+static void test_servo_pwm_is_clamped() {
+    I2CBus::instance().begin(GPIO_NUM_NC, GPIO_NUM_NC);
+    ServoController servos;
+    servos.begin();
+    servos.activate();
+    // Far past the end of travel in the direction that raises each servo's PWM.
+    float extreme[12];
+    for (int i = 0; i < 12; i++) extreme[i] = 1000 * servos.state().servos[i].direction;
+    servos.setAngles(extreme);
+    host_i2c::resetStats();
+    for (int i = 0; i < 100; i++) servos.update();
+    // Once every channel sits at the clamp nothing changes, so later ticks send nothing.
+    CHECK(host_i2c::stats().transactions >= 1 && host_i2c::stats().transactions < 100);
+    const uint32_t settled = host_i2c::stats().transactions;
+    for (int i = 0; i < 10; i++) servos.update();
+    CHECK(host_i2c::stats().transactions == settled);
+    CHECK(allChannelsAt(ServoPWMTable::MAX_PWM));
+
+    for (float &a : extreme) a = -a;
+    servos.setAngles(extreme);
+    for (int i = 0; i < 100; i++) servos.update();
+    CHECK(allChannelsAt(ServoPWMTable::MIN_PWM));
+    I2CBus::instance().end();
+}
+
+static void test_servo_frames_write_only_changed_channels() {
+    I2CBus::instance().begin(GPIO_NUM_NC, GPIO_NUM_NC);
+    PCA9685Driver pca;
+    uint16_t pwms[12];
+    std::fill_n(pwms, 12, 300);
+    const int64_t start = 5000000;
+
+    host_i2c::resetStats();
+    pca.updatePWM(pwms, 12, start);
+    CHECK(host_i2c::stats().transactions == 1);
+    CHECK(host_i2c::stats().bytes_written == 12 * 4 + 1);
+
+    host_i2c::resetStats();
+    pca.updatePWM(pwms, 12, start + 10000);
+    CHECK(host_i2c::stats().transactions == 0);
+
+    // Separate channels go out as separate runs, neighbours share one.
+    pwms[1] = 310;
+    pwms[10] = 320;
+    pca.updatePWM(pwms, 12, start + 20000);
+    CHECK(host_i2c::stats().transactions == 2);
+    CHECK(host_i2c::stats().bytes_written == 2 * (4 + 1));
+    host_i2c::resetStats();
+    pwms[4] = 330;
+    pwms[5] = 340;
+    pca.updatePWM(pwms, 12, start + 30000);
+    CHECK(host_i2c::stats().transactions == 1);
+    CHECK(host_i2c::stats().bytes_written == 2 * 4 + 1);
+
+    // A single channel write bypasses the shadow frame, so the next update resends everything.
+    host_i2c::resetStats();
+    pca.setPWM(3, 0, 200);
+    pca.updatePWM(pwms, 12, start + 40000);
+    CHECK(host_i2c::stats().transactions == 2);
+    CHECK(host_i2c::stats().bytes_written == (4 + 1) + (12 * 4 + 1));
+
+    // Periodic full refresh even when nothing changed.
+    host_i2c::resetStats();
+    pca.updatePWM(pwms, 12, start + 40000 + PCA9685Driver::FULL_REFRESH_US - 1);
+    CHECK(host_i2c::stats().transactions == 0);
+    pca.updatePWM(pwms, 12, start + 40000 + PCA9685Driver::FULL_REFRESH_US);
+    CHECK(host_i2c::stats().transactions == 1);
+    CHECK(host_i2c::stats().bytes_written == 12 * 4 + 1);
+    I2CBus::instance().end();
+}
+
+static void test_servo_table_matches_float_calibration() {
+    const ServoSettings settings = ServoSettings_defaults();
+    ServoPWMTable table;
+    table.rebuild(settings);
+
+    int worst = 0;
+    for (float deg = -200; deg <= 200; deg += 0.37f) {
+        servo_angle_t angles[12];
+        uint16_t pwms[12];
+        std::fill_n(angles, 12, servo_angle_t(deg));
+        table.step(angles, pwms);
+        for (int i = 0; i < 12; i++) {
+            const api_Servo &servo = settings.servos[i];
+            const float reference = (servo.direction * deg + servo.center_angle) * servo.conversion + servo.center_pwm;
+            const int expected = std::clamp(static_cast<int>(std::floor(reference)), 125, 600);
+            worst = std::max(worst, std::abs(pwms[i] - expected));
+        }
+    }
+    CHECK(worst <= 1);
+}
+
+static void test_servo_table_follows_calibration_points() {
+    ServoSettings settings = ServoSettings_defaults();
+    api_Servo &servo = settings.servos[0];
+    // Out of order on purpose, with a duplicate angle; the compiled curve sorts and dedupes.
+    servo.points_count = 4;
+    servo.points[0] = {30, 400};
+    servo.points[1] = {-30, 250};
+    servo.points[2] = {0, 300};
+    servo.points[3] = {30, 400};
+    ServoPWMTable table;
+    table.rebuild(settings);
+
+    CHECK(table.ticks(0, servo_angle_t(-30)) == 250);
+    CHECK(table.ticks(0, servo_angle_t(0)) == 300);
+    CHECK(table.ticks(0, servo_angle_t(15.5f)) == 351);
+    CHECK(table.ticks(0, servo_angle_t(30)) == 400);
+    // Past the points the end segments extrapolate, past the table its end interval does.
+    CHECK(table.ticks(0, servo_angle_t(-60)) == 200);
+    CHECK(table.ticks(0, servo_angle_t(60)) == 500);
+    CHECK_NEAR(table.ticks(0, servo_angle_t(-200)), 250 - 170 * 5 / 3.0f, 1);
+    // Channels without points keep the linear terms.
+    CHECK(table.ticks(1, servo_angle_t(0)) == 306 - 45 * 2);
+}
+
+static void test_servo_calibration_capture() {
+    I2CBus::instance().begin(GPIO_NUM_NC, GPIO_NUM_NC);
+    ServoController servos;
+    servos.begin();
+    CHECK(servos.pwmTable().ticks(2, servo_angle_t(0)) == 306 + 2 * 90);
+
+    // Nothing to capture until the servo has been jogged.
+    CHECK(servos.captureCalibrationPoint(2, 0) == -1);
+    servos.setServoPWM(2, 320);
+    CHECK(servos.captureCalibrationPoint(2, 0) == 1);
+    servos.setServoPWM(2, 420);
+    CHECK(servos.captureCalibrationPoint(2, 40) == 2);
+    // A capture near an existing angle replaces it.
+    servos.setServoPWM(2, 330);
+    CHECK(servos.captureCalibrationPoint(2, 0.2f) == 2);
+    CHECK_NEAR(servos.pwmTable().ticks(2, servo_angle_t(0.2f)), 330, 1);
+    CHECK_NEAR(servos.pwmTable().ticks(2, servo_angle_t(20.1f)), 375, 1);
+
+    for (int i = 2; i < ServoController::MAX_CALIBRATION_POINTS; i++)
+        CHECK(servos.captureCalibrationPoint(2, 50 + i) == i + 1);
+    CHECK(servos.captureCalibrationPoint(2, 90) == -1);
+
+    CHECK(servos.clearCalibration(2) == 0);
+    CHECK(servos.pwmTable().ticks(2, servo_angle_t(0)) == 306 + 2 * 90);
+    I2CBus::instance().end();
+}
+
+int main() {
+    RUN_TEST(test_walk_moves_feet);
+    RUN_TEST(test_swing_table_matches_bezier);
+    RUN_TEST(test_motion_service_update_uses_clock);
+    RUN_TEST(test_trajectory_is_rate_independent);
+    RUN_TEST(test_trajectory_jerk_limit);
+    RUN_TEST(test_trajectory_tracks_target_within_limits);
+    RUN_TEST(test_motion_service_limits_joint_speed);
+    RUN_TEST(test_update_angles_follows_small_moves);
+    RUN_TEST(test_loop_timer_wakes_at_rate);
+    RUN_TEST(test_motion_service_is_loop_rate_independent);
+    RUN_TEST(test_mailbox_latest_value_wins);
+    RUN_TEST(test_mailbox_reads_are_never_torn);
+    RUN_TEST(test_motion_service_applies_input_once_per_tick);
+    RUN_TEST(test_command_log_round_trip);
+    RUN_TEST(test_command_replay_matches_live_run);
+    RUN_TEST(test_flight_recorder_dumps_ring_oldest_first);
+    RUN_TEST(test_flight_recorder_triggers);
+    RUN_TEST(test_flight_recorder_tilt_from_imu_radians);
+    RUN_TEST(test_flight_recorder_tilt_from_bno055);
+    RUN_TEST(test_trace_exports_chrome_json);
+    RUN_TEST(test_task_stats_deltas);
+    RUN_TEST(test_latency_histogram_percentiles);
+    RUN_TEST(test_loop_profiler_reports_stages_and_jitter);
+    RUN_TEST(test_loop_profiler_report_contents);
+    RUN_TEST(test_servo_pwm_is_clamped);
+    RUN_TEST(test_servo_frames_write_only_changed_channels);
+    RUN_TEST(test_servo_table_matches_float_calibration);
+    RUN_TEST(test_servo_table_follows_calibration_points);
+    RUN_TEST(test_servo_calibration_capture);
+    return host_test::failures;
+}
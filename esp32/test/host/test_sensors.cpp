@@ -0,0 +1,405 @@
+#include "host_test.h"
+
+#include <peripherals/drivers/bmp180.h>
+#include <peripherals/drivers/mpu6050.h>
+#include <peripherals/sonar.h>
+#include <utils/attitude_filter.h>
+#include <utils/median_filter.h>
+#include <utils/ring_buffer.h>
+
+#include <random>
+#include <vector>
+
+static void test_median_filter_rejects_spikes() {
+    MedianFilter<float, 5> filter;
+    CHECK(filter.value() == 0.0f);
+    CHECK(filter.push(40.0f) == 40.0f);
+    filter.push(41.0f);
+    filter.push(39.0f);
+    CHECK(filter.push(200.0f) == 41.0f); // lost echo
+    CHECK(filter.push(40.0f) == 40.0f);
+    CHECK(filter.push(3.0f) == 40.0f); // cross talk
+    CHECK(filter.size() == 5);
+    filter.reset();
+    CHECK(filter.size() == 0);
+    CHECK(filter.push(10.0f) == 10.0f);
+}
+
+// Scripted stand-in for HCSR04Driver: each ping echoes after `delay_us` with the next scripted distance, or never
+// for a negative distance.
+struct FakeRanger {
+    enum class Status { IDLE, PENDING, DONE, NO_ECHO };
+
+    bool begin(int trigger, int echo, float) { return trigger >= 0 && echo >= 0; }
+
+    bool trigger(int64_t now) {
+        if (status == Status::PENDING) return false;
+        pings.push_back(now);
+        status = Status::PENDING;
+        return true;
+    }
+
+    Status poll(float &cm, int64_t now) {
+        if (status != Status::PENDING) return status;
+        const float next = script[(pings.size() - 1) % script.size()];
+        if (next < 0) {
+            if (now - pings.back() > 12000) status = Status::NO_ECHO;
+        } else if (now - pings.back() >= delay_us) {
+            cm = next;
+            status = Status::DONE;
+        }
+        return status;
+    }
+
+    std::vector<float> script {50.0f};
+    std::vector<int64_t> pings;
+    int64_t delay_us {3000};
+    Status status {Status::IDLE};
+};
+
+static void test_sonar_alternates_and_never_blocks() {
+    SonarPair<FakeRanger, 3> sonar;
+    CHECK(sonar.initialize(4, 4, 5, 5, 200));
+    sonar.driver(SonarPair<FakeRanger, 3>::LEFT).script = {30.0f, 31.0f, -1.0f, 29.0f};
+    sonar.driver(SonarPair<FakeRanger, 3>::RIGHT).script = {80.0f};
+
+    int fresh = 0;
+    for (int64_t now = 0; now < 600000; now += 10000) fresh += sonar.update(now);
+
+    const auto &left = sonar.driver(SonarPair<FakeRanger, 3>::LEFT).pings;
+    const auto &right = sonar.driver(SonarPair<FakeRanger, 3>::RIGHT).pings;
+    CHECK(left.size() >= 8 && right.size() >= 8);
+    CHECK(left.size() - right.size() <= 1);
+    // Pings alternate sides and honour the spacing.
+    for (size_t i = 0; i < right.size(); i++) {
+        CHECK(right[i] > left[i]);
+        CHECK(right[i] - left[i] >= SONAR_PING_INTERVAL_US);
+    }
+    CHECK(fresh >= 16);
+
+    // The missed echo reads as max range but the median keeps the left side near 30 cm.
+    CHECK(sonar.reading(SonarPair<FakeRanger, 3>::LEFT).distance < 32.0f);
+    CHECK(sonar.reading(SonarPair<FakeRanger, 3>::RIGHT).distance == 80.0f);
+    CHECK(sonar.reading(SonarPair<FakeRanger, 3>::LEFT).time == left.back() ||
+          sonar.reading(SonarPair<FakeRanger, 3>::LEFT).time == left[left.size() - 2]);
+}
+
+static void test_sonar_single_side() {
+    SonarPair<FakeRanger, 3> sonar;
+    CHECK(sonar.initialize(-1, -1, 5, 5, 200));
+    CHECK(sonar.isActive());
+    for (int64_t now = 0; now < 200000; now += 10000) sonar.update(now);
+    CHECK(sonar.driver(SonarPair<FakeRanger, 3>::LEFT).pings.empty());
+    CHECK(sonar.driver(SonarPair<FakeRanger, 3>::RIGHT).pings.size() >= 5);
+    CHECK(sonar.reading(SonarPair<FakeRanger, 3>::LEFT).distance == 200.0f);
+    CHECK(sonar.reading(SonarPair<FakeRanger, 3>::LEFT).time == 0);
+    CHECK(sonar.reading(SonarPair<FakeRanger, 3>::RIGHT).distance == 50.0f);
+
+    SonarPair<FakeRanger, 3> none;
+    CHECK(!none.initialize(-1, -1, -1, -1, 200));
+    CHECK(!none.update(0));
+}
+
+// Worked example from the BMP180 datasheet (section 3.5).
+static void test_bmp180_compensation_matches_datasheet() {
+    const bmp180_calibration_t cal {408, -72, -14383, 32741, 32757, 23153, 6190, 4, -32768, -8711, 2868};
+    BMP180Compensation compensation(cal, 0);
+    CHECK(compensation.setTemperature(27898) == 150);
+    CHECK(compensation.pressure(23843) == 69964);
+    // Pressure terms are cached per temperature, so repeated samples give the same answer.
+    CHECK(compensation.pressure(23843) == 69964);
+    CHECK(compensation.pressure(23900) > 69964);
+}
+
+// The same example end to end: readings are collected through the I2C queue, served inline with no bus worker.
+static void test_bmp180_reads_through_the_queue() {
+    I2CBus &bus = I2CBus::instance();
+    bus.begin(GPIO_NUM_NC, GPIO_NUM_NC);
+    const uint8_t addr = BMP180Driver::DEFAULT_ADDR;
+    const uint8_t id = 0x55;
+    host_i2c::setRegisters(addr, 0xD0, &id, 1);
+    const int32_t cal[11] = {408, -72, -14383, 32741, 32757, 23153, 6190, 4, -32768, -8711, 2868};
+    uint8_t raw[22];
+    for (int i = 0; i < 11; i++) {
+        raw[2 * i] = static_cast<uint16_t>(cal[i]) >> 8;
+        raw[2 * i + 1] = static_cast<uint16_t>(cal[i]) & 0xFF;
+    }
+    host_i2c::setRegisters(addr, 0xAA, raw, sizeof(raw));
+    BMP180Driver bmp;
+    CHECK(bmp.begin());
+    CHECK(!bus.hasWorker());
+
+    const uint8_t ut[2] = {27898 >> 8, 27898 & 0xFF};
+    host_i2c::setRegisters(addr, 0xF6, ut, sizeof(ut));
+    CHECK(!bmp.update(0));
+    CHECK(!bmp.update(1000)); // conversion still running
+    CHECK(!bmp.update(5000));
+    CHECK_NEAR(bmp.getTemperature(), 15.0f, 1e-3);
+
+    const uint8_t up[3] = {23843 >> 8, 23843 & 0xFF, 0};
+    host_i2c::setRegisters(addr, 0xF6, up, sizeof(up));
+    CHECK(bmp.update(10000));
+    CHECK_NEAR(bmp.getPressure(), 699.64f, 1e-3);
+
+    i2c_device_stats_t stats[4];
+    const size_t count = bus.deviceStats(stats, 4);
+    CHECK(count == 1 && stats[0].address == addr && stats[0].errors == 0 && stats[0].bytes_read == 1 + 22 + 2 + 3);
+    bus.end();
+}
+
+static void test_ring_buffer_keeps_newest() {
+    RingBuffer<int, 4> ring;
+    CHECK(ring.empty());
+    for (int i = 1; i <= 6; i++) ring.push(i);
+    CHECK(ring.size() == 4);
+    CHECK(ring[0] == 3);
+    CHECK(ring[3] == 6);
+    CHECK(ring.back() == 6);
+    ring.clear();
+    ring.push(9);
+    CHECK(ring.size() == 1 && ring[0] == 9 && ring.back() == 9);
+}
+
+// DMP packet carrying quaternion w, x, y, z as big-endian Q30 words.
+static void writeDmpPacket(uint8_t *packet, float w, float x, float y, float z) {
+    const float q[4] = {w, x, y, z};
+    for (int i = 0; i < 4; i++) {
+        const int32_t fixed = static_cast<int32_t>(q[i] * 16384.0f) << 16;
+        packet[4 * i] = fixed >> 24;
+        packet[4 * i + 1] = fixed >> 16;
+        packet[4 * i + 2] = fixed >> 8;
+        packet[4 * i + 3] = fixed;
+    }
+}
+
+static void test_mpu6050_burst_is_timestamped_oldest_first() {
+    MPU6050Driver imu;
+    uint8_t burst[3 * 28] = {};
+    const float half = std::sqrt(0.5f);
+    writeDmpPacket(burst, 1, 0, 0, 0);
+    writeDmpPacket(burst + 28, half, half, 0, 0);
+    writeDmpPacket(burst + 56, half, 0, half, 0);
+
+    imu.ingestPackets(burst, 1, 100000);
+    CHECK(imu.getSampleTime() == 100000);
+    imu.ingestPackets(burst, 3, 130000);
+
+    const auto &packets = imu.packets();
+    CHECK(packets.size() == 4);
+    CHECK(packets.back().time == 130000);
+    CHECK(packets[3].time - packets[2].time == imu.samplePeriodUs());
+    CHECK(packets[2].time - packets[1].time == imu.samplePeriodUs());
+    CHECK(packets[1].time > packets[0].time);
+    CHECK_NEAR(packets[2].q[1], half, 1e-3);
+    CHECK_NEAR(packets[3].q[2], half, 1e-3);
+    // Attitude follows the newest packet: 90 degrees of pitch.
+    CHECK_NEAR(std::fabs(imu.getPitch()), M_PI / 2, 1e-2);
+}
+
+/*
+ * Raw MPU6050 FIFO recording of a robot rocking in roll, pitch and yaw, synthesised from a reference quaternion
+ * integrated at 10 kHz: 1 kHz samples with gyro bias and noise, accelerometer noise, quantised to the sensor's
+ * +-500 dps / +-2 g counts. Also keeps the true gravity direction for each sample.
+ */
+struct ImuRecording {
+    std::vector<uint8_t> fifo; // 12 bytes per sample, as MPU6050Driver reads it in RAW mode
+    std::vector<float> gravity; // 3 per sample
+    size_t samples() const { return gravity.size() / 3; }
+};
+
+static void gravityOf(const double q[4], float g[3]) {
+    g[0] = 2 * (q[1] * q[3] - q[0] * q[2]);
+    g[1] = 2 * (q[0] * q[1] + q[2] * q[3]);
+    g[2] = q[0] * q[0] - q[1] * q[1] - q[2] * q[2] + q[3] * q[3];
+}
+
+static ImuRecording recordImu(double seconds) {
+    ImuRecording rec;
+    std::mt19937 rng(7);
+    std::normal_distribution<double> gyro_noise(0, 0.004), accel_noise(0, 0.01);
+    const double bias[3] = {0.004, -0.003, 0.002};
+    double q[4] = {1, 0, 0, 0};
+    const int substeps = 10;
+    const double dt = 0.001 / substeps;
+    auto push16 = [&](double value) {
+        const int16_t raw = static_cast<int16_t>(std::lround(std::clamp(value, -32768.0, 32767.0)));
+        rec.fifo.push_back(static_cast<uint16_t>(raw) >> 8);
+        rec.fifo.push_back(static_cast<uint16_t>(raw) & 0xFF);
+    };
+    for (int n = 0; n < seconds * 1000; n++) {
+        double w[3] = {};
+        for (int k = 0; k < substeps; k++) {
+            const double t = (n * substeps + k) * dt;
+            w[0] = 1.2 * std::sin(2 * M_PI * 0.7 * t);
+            w[1] = 0.9 * std::cos(2 * M_PI * 0.4 * t);
+            w[2] = 0.5 * std::sin(2 * M_PI * 0.25 * t);
+            const double dq[4] = {0.5 * (-q[1] * w[0] - q[2] * w[1] - q[3] * w[2]),
+                                  0.5 * (q[0] * w[0] + q[2] * w[2] - q[3] * w[1]),
+                                  0.5 * (q[0] * w[1] - q[1] * w[2] + q[3] * w[0]),
+                                  0.5 * (q[0] * w[2] + q[1] * w[1] - q[2] * w[0])};
+            double norm = 0;
+            for (int i = 0; i < 4; i++) {
+                q[i] += dq[i] * dt;
+                norm += q[i] * q[i];
+            }
+            for (int i = 0; i < 4; i++) q[i] /= std::sqrt(norm);
+        }
+        float g[3];
+        gravityOf(q, g);
+        for (int i = 0; i < 3; i++) push16((g[i] + accel_noise(rng)) * 16384.0);
+        for (int i = 0; i < 3; i++) push16((w[i] + bias[i] + gyro_noise(rng)) * 65.5 * RAD2DEG_F);
+        rec.gravity.insert(rec.gravity.end(), g, g + 3);
+    }
+    return rec;
+}
+
+static float tiltErrorDeg(const float q[4], const float *truth) {
+    const double qd[4] = {q[0], q[1], q[2], q[3]};
+    float g[3];
+    gravityOf(qd, g);
+    const float dot = g[0] * truth[0] + g[1] * truth[1] + g[2] * truth[2];
+    return std::acos(std::clamp(dot, -1.0f, 1.0f)) * RAD2DEG_F;
+}
+
+static void test_mpu6050_raw_mode_tracks_replayed_motion() {
+    const ImuRecording rec = recordImu(10.0);
+    MPU6050Driver imu(MPU6050Driver::DEFAULT_ADDR, MPU6050Driver::Mode::RAW);
+
+    // Drained in 10 ms bursts like the sensor task does; the first two seconds let the filter converge.
+    float worst = 0;
+    for (size_t n = 0; n < rec.samples(); n += 10) {
+        imu.ingestPackets(&rec.fifo[n * 12], 10, static_cast<int64_t>(n + 9) * 1000);
+        if (n < 2000) continue;
+        const auto &packets = imu.packets();
+        for (size_t i = 0; i < 10; i++)
+            worst = std::max(worst, tiltErrorDeg(packets[packets.size() - 10 + i].q, &rec.gravity[(n + i) * 3]));
+    }
+    printf("  raw mode worst tilt error %.2f deg\n", worst);
+    CHECK(worst < 2.0f);
+    CHECK(imu.packets().back().time == static_cast<int64_t>(rec.samples() - 1) * 1000);
+    CHECK(imu.packets()[0].time == imu.packets().back().time - 15 * MPU6050Driver::RAW_SAMPLE_PERIOD_US);
+}
+
+static void test_madgwick_fixed_point_matches_float() {
+    const ImuRecording rec = recordImu(10.0);
+    MadgwickFloat reference;
+    MadgwickFixed fixed;
+    const float gyro = DEG2RAD_F / 65.5f, accel = 1.0f / 16384.0f;
+    float worst = 0;
+    for (size_t n = 0; n < rec.samples(); n++) {
+        const uint8_t *packet = &rec.fifo[n * 12];
+        int16_t raw[6];
+        for (int i = 0; i < 6; i++) raw[i] = static_cast<int16_t>((packet[2 * i] << 8) | packet[2 * i + 1]);
+        reference.update(gyro * raw[3], gyro * raw[4], gyro * raw[5], accel * raw[0], accel * raw[1], accel * raw[2],
+                         0.001f);
+        fixed.update(Fixed<24>(gyro) * raw[3], Fixed<24>(gyro) * raw[4], Fixed<24>(gyro) * raw[5],
+                     Fixed<24>(accel) * raw[0], Fixed<24>(accel) * raw[1], Fixed<24>(accel) * raw[2], 0.001f);
+        float a[4], b[4];
+        reference.quaternion(a);
+        fixed.quaternion(b);
+        const double qa[4] = {a[0], a[1], a[2], a[3]};
+        float ga[3];
+        gravityOf(qa, ga);
+        worst = std::max(worst, tiltErrorDeg(b, ga));
+    }
+    printf("  fixed vs float worst tilt difference %.3f deg\n", worst);
+    CHECK(worst < 0.5f);
+}
+
+static void test_i2c_bus_keeps_a_handle_per_device() {
+    I2CBus &bus = I2CBus::instance();
+    bus.begin(GPIO_NUM_NC, GPIO_NUM_NC);
+    host_i2c::resetStats();
+    uint8_t frame[8] = {};
+    uint8_t reading[6];
+    for (int i = 0; i < 50; i++) {
+        bus.writeReg(0x40, 0x06, frame, sizeof(frame));
+        bus.readReg(0x68, 0x3B, reading, sizeof(reading));
+    }
+    CHECK(host_i2c::stats().devices_added == 2);
+    CHECK(host_i2c::stats().devices_removed == 0);
+
+    i2c_device_stats_t stats[4];
+    CHECK(bus.deviceStats(stats, 4) == 2);
+    CHECK(stats[0].address == 0x40 && stats[1].address == 0x68);
+    CHECK(stats[0].transactions == 50 && stats[0].bytes_written == 50 * 9 && stats[0].bytes_read == 0);
+    CHECK(stats[1].transactions == 50 && stats[1].bytes_written == 50 && stats[1].bytes_read == 50 * 6);
+    CHECK(stats[0].errors == 0 && stats[1].errors == 0);
+    bus.resetStats();
+    bus.deviceStats(stats, 4);
+    CHECK(stats[1].address == 0x68 && stats[1].transactions == 0);
+
+    bus.end();
+    CHECK(host_i2c::stats().devices_removed == 2);
+}
+
+static void test_i2c_queue_runs_by_priority_then_deadline() {
+    I2CBus &bus = I2CBus::instance();
+    bus.begin(GPIO_NUM_NC, GPIO_NUM_NC);
+
+    struct Done {
+        std::vector<int> order;
+        std::vector<esp_err_t> results;
+    } done;
+    struct Tag {
+        Done *done;
+        int id;
+    } tags[5];
+    auto make = [&](int id, uint8_t addr, I2CPriority priority, int64_t deadline) {
+        tags[id] = {&done, id};
+        i2c_transaction_t t;
+        t.addr = addr;
+        t.priority = priority;
+        t.write_len = 2;
+        t.write[0] = 0x00;
+        t.write[1] = id;
+        t.deadline = deadline;
+        t.ctx = &tags[id];
+        t.done = [](esp_err_t err, void *ctx) {
+            auto *tag = static_cast<Tag *>(ctx);
+            tag->done->order.push_back(tag->id);
+            tag->done->results.push_back(err);
+        };
+        return t;
+    };
+    const int64_t now = esp_timer_get_time();
+    CHECK(bus.submit(make(0, 0x77, I2CPriority::SENSOR, 0)) == ESP_OK);
+    CHECK(bus.submit(make(1, 0x1E, I2CPriority::BACKGROUND, 0)) == ESP_OK);
+    CHECK(bus.submit(make(2, 0x68, I2CPriority::SENSOR, now + 1000000)) == ESP_OK);
+    CHECK(bus.submit(make(3, 0x40, I2CPriority::SERVO, now + 2000000)) == ESP_OK);
+    CHECK(bus.submit(make(4, 0x68, I2CPriority::SENSOR, now - 1)) == ESP_OK);
+    bus.runPending();
+
+    CHECK(done.order == std::vector<int>({3, 4, 2, 0, 1}));
+    CHECK(done.results[1] == ESP_ERR_TIMEOUT);
+    CHECK(done.results[0] == ESP_OK && done.results[2] == ESP_OK && done.results[4] == ESP_OK);
+    i2c_device_stats_t stats[8];
+    const size_t n = bus.deviceStats(stats, 8);
+    for (size_t i = 0; i < n; i++)
+        if (stats[i].address == 0x68) CHECK(stats[i].expired == 1 && stats[i].transactions == 1);
+
+    i2c_transaction_t filler;
+    filler.addr = 0x40;
+    int accepted = 0;
+    while (bus.submit(filler) == ESP_OK) accepted++;
+    CHECK(accepted == 16);
+    bus.runPending();
+    CHECK(bus.submit(filler) == ESP_OK);
+    bus.runPending();
+    bus.end();
+}
+
+int main() {
+    RUN_TEST(test_median_filter_rejects_spikes);
+    RUN_TEST(test_sonar_alternates_and_never_blocks);
+    RUN_TEST(test_sonar_single_side);
+    RUN_TEST(test_bmp180_compensation_matches_datasheet);
+    RUN_TEST(test_bmp180_reads_through_the_queue);
+    RUN_TEST(test_ring_buffer_keeps_newest);
+    RUN_TEST(test_mpu6050_burst_is_timestamped_oldest_first);
+    RUN_TEST(test_mpu6050_raw_mode_tracks_replayed_motion);
+    RUN_TEST(test_madgwick_fixed_point_matches_float);
+    RUN_TEST(test_i2c_bus_keeps_a_handle_per_device);
+    RUN_TEST(test_i2c_queue_runs_by_priority_then_deadline);
+    return host_test::failures;
+}